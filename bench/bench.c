@@ -0,0 +1,433 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <malloc.h>
+#include "ast.h"
+#include "bench.h"
+#include "builtins.h"
+
+/*
+ * Microbenchmarks for the hot paths of the shell. src/main.c is linked in
+ * with main() renamed, so these call the real ast_parse(), handle_tab(),
+ * launch() and the AST evaluator. Every result is one JSON object per line
+ * on stdout.
+ */
+
+// Defined in src/main.c
+String handle_tab(String buffer);
+int launch(String *args, int argc);
+
+#define BENCH_REPS 5
+#define BENCH_TARGET_NS 100000000ull    // aim for ~100 ms per repetition
+
+typedef void (*bench_fn)(void *ctx);
+
+static char bench_home[PATH_MAX];
+static int saved_stdout = -1;
+static long bench_entries = -1;     // reported when >= 0: how much input was really used
+
+// Commands under test print to stdout; keep that out of the JSON stream
+static void quiet_begin(void) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int fd = open("/dev/null", O_WRONLY);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+}
+
+static void quiet_end(void) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+static void run(const char *bench, const char *variant, bench_fn fn, void *ctx) {
+    quiet_begin();
+    fn(ctx);    // warm caches, e.g. the PATH cache built on the first TAB
+
+    // Grow the batch until it is long enough to time, then scale to target
+    uint64_t iters = 1, elapsed = 0;
+    for (;;) {
+        uint64_t start = bench_now_ns();
+        for (uint64_t i = 0; i < iters; i++) fn(ctx);
+        elapsed = bench_now_ns() - start;
+        if (elapsed >= BENCH_TARGET_NS / 10 || iters >= (1u << 30)) break;
+        iters *= 2;
+    }
+    iters = elapsed ? iters * BENCH_TARGET_NS / elapsed : iters;
+    if (iters == 0) iters = 1;
+
+    uint64_t per_op[BENCH_REPS];
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t start = bench_now_ns();
+        for (uint64_t i = 0; i < iters; i++) fn(ctx);
+        per_op[r] = (bench_now_ns() - start) / iters;
+    }
+
+    quiet_end();
+
+    qsort(per_op, BENCH_REPS, sizeof(uint64_t), bench_compare_u64);
+    printf("{\"rev\":\"%s\",\"bench\":\"%s\",\"variant\":\"%s\",", bench_rev(), bench, variant);
+    if (bench_entries >= 0) printf("\"entries\":%ld,", bench_entries);
+    printf("\"iterations\":%llu,\"reps\":%d,"
+           "\"ns_per_op_min\":%llu,\"ns_per_op_median\":%llu,\"ns_per_op_max\":%llu}\n",
+           (unsigned long long)iters, BENCH_REPS,
+           (unsigned long long)per_op[0], (unsigned long long)per_op[BENCH_REPS / 2],
+           (unsigned long long)per_op[BENCH_REPS - 1]);
+    fflush(stdout);
+}
+
+// Comma separated sizes from the environment, e.g. "10000,100000"
+static int read_sizes(const char *var, const char *fallback, long *sizes, int max) {
+    const char *spec = getenv(var);
+    if (!spec || !*spec) spec = fallback;
+
+    int n = 0;
+    while (*spec && n < max) {
+        char *end;
+        long v = strtol(spec, &end, 10);
+        if (end == spec) break;
+        if (v > 0) sizes[n++] = v;
+        spec = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftw) {
+    return remove(path);
+}
+
+static void remove_tree(const char *path) {
+    nftw(path, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+/* ast_parse */
+
+static void bench_ast_parse(void *ctx) {
+    Node *tree;
+    ast_parse(ctx, &tree);
+    ast_free(tree);
+}
+
+static void parse_benches(void) {
+    char long_line[BUFFER_MAX_SIZE] = "gcc";
+    for (int i = 0; i < 64; i++) {
+        char arg[16];
+        snprintf(arg, sizeof(arg), " -Dflag%d=1", i);
+        strncat(long_line, arg, sizeof(long_line) - strlen(long_line) - 1);
+    }
+
+    struct { const char *variant; const char *line; } cases[] = {
+        {"short", "ls -la /tmp"},
+        {"long_64_args", long_line},
+        {"variables", "echo $HOME $PATH $USER $?"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        run("ast_parse", cases[i].variant, bench_ast_parse, (void *)cases[i].line);
+}
+
+/* handle_tab */
+
+typedef struct TabCase {
+    const char *input;
+} TabCase;
+
+static void bench_tab(void *ctx) {
+    TabCase *tc = ctx;
+    String buffer = {.chars = strdup(tc->input), .len = (int)strlen(tc->input)};
+    buffer = handle_tab(buffer);
+    free(buffer.chars);
+}
+
+static bool make_entries(const char *dir, long count) {
+    if (mkdir(dir, 0755) != 0) return false;
+    int dfd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (dfd < 0) return false;
+    for (long i = 0; i < count; i++) {
+        char entry[32];
+        snprintf(entry, sizeof(entry), "f%08ld", i);
+        int fd = openat(dfd, entry, O_CREAT | O_WRONLY, 0644);
+        if (fd < 0) {
+            close(dfd);
+            return false;
+        }
+        close(fd);
+    }
+    close(dfd);
+    return true;
+}
+
+static void tab_benches(void) {
+    TabCase path = {.input = "ec"};
+    run("handle_tab", "path_prefix", bench_tab, &path);
+
+    long sizes[8];
+    int n = read_sizes("HERMES_BENCH_TAB_SIZES", "10000,100000,1000000", sizes, 8);
+    for (int i = 0; i < n; i++) {
+        char dir[PATH_MAX + 32], input[PATH_MAX + 64], variant[64];
+        snprintf(dir, sizeof(dir), "%s/tab_%ld", bench_home, sizes[i]);
+        if (!make_entries(dir, sizes[i])) {
+            fprintf(stderr, "bench: cannot create %s: %s\n", dir, strerror(errno));
+            remove_tree(dir);
+            continue;
+        }
+
+        // A unique completion: every entry is read, one is stat()ed
+        snprintf(input, sizeof(input), "ls %s/f%08ld", dir, sizes[i] / 2);
+        TabCase unique = {.input = input};
+        snprintf(variant, sizeof(variant), "dir_%ld_unique", sizes[i]);
+        run("handle_tab", variant, bench_tab, &unique);
+
+        // A 10% prefix: many candidates, all stat()ed and listed
+        int digits = snprintf(NULL, 0, "%ld", sizes[i] - 1);
+        snprintf(input, sizeof(input), "ls %s/f%0*d", dir, 8 - digits + 1, 0);
+        TabCase listing = {.input = input};
+        snprintf(variant, sizeof(variant), "dir_%ld_listing", sizes[i]);
+        run("handle_tab", variant, bench_tab, &listing);
+
+        remove_tree(dir);
+    }
+}
+
+/* history */
+
+static void bench_read_history(void *ctx) {
+    History history;
+    read_history(&history);
+    free_history(&history);
+}
+
+static void bench_builtin_history(void *ctx) {
+    builtin_history(ctx);
+}
+
+static bool write_history_file(long lines) {
+    char path[PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/.history", bench_home);
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    for (long i = 0; i < lines; i++)
+        fprintf(f, "git commit -m \"change %ld\" --author=dev%ld src/file%ld.c\n", i, i % 97, i % 1013);
+    fclose(f);
+    return true;
+}
+
+static void history_benches(void) {
+    long sizes[8];
+    int n = read_sizes("HERMES_BENCH_HISTORY_SIZES", "1000000,4000000", sizes, 8);
+    for (int i = 0; i < n; i++) {
+        if (!write_history_file(sizes[i])) continue;
+
+        // The variant names the file size; entries is what read_history() kept
+        History history = {0};
+        read_history(&history);
+        bench_entries = history.count;
+        free_history(&history);
+
+        char variant[64];
+        snprintf(variant, sizeof(variant), "lines_%ld", sizes[i]);
+        run("read_history", variant, bench_read_history, NULL);
+
+        String all[] = {{"history", 7}, {NULL, 0}};
+        run("builtin_history", variant, bench_builtin_history, all);
+
+        snprintf(variant, sizeof(variant), "lines_%ld_filter", sizes[i]);
+        String filtered[] = {{"history", 7}, {"file1012.c", 10}, {NULL, 0}};
+        run("builtin_history", variant, bench_builtin_history, filtered);
+        bench_entries = -1;
+    }
+}
+
+/* history storage layout: strdup per entry (before) vs. one arena (after) */
+
+typedef struct LegacyEntry {
+    int id;
+    char *command;
+} LegacyEntry;
+
+static long rss_kb(void) {
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return -1;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = -1;
+    fclose(f);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void report_layout(const char *variant, long entries, uint64_t load_ns, uint64_t scan_ns, uint64_t free_ns, long rss, long hits) {
+    printf("{\"rev\":\"%s\",\"bench\":\"history_layout\",\"variant\":\"%s\",\"entries\":%ld,"
+           "\"load_ns\":%llu,\"scan_ns\":%llu,\"free_ns\":%llu,\"rss_kb\":%ld,\"hits\":%ld}\n",
+           bench_rev(), variant, entries, (unsigned long long)load_ns, (unsigned long long)scan_ns,
+           (unsigned long long)free_ns, rss, hits);
+    fflush(stdout);
+}
+
+static void layout_benches(void) {
+    const char *needle = "file1012.c";
+    size_t needle_len = strlen(needle);
+    char path[PATH_MAX + 16], variant[64];
+    snprintf(path, sizeof(path), "%s/.history", bench_home);
+
+    long sizes[8];
+    int n = read_sizes("HERMES_BENCH_LAYOUT_SIZES", "1000000", sizes, 8);
+    for (int s = 0; s < n; s++) {
+        if (!write_history_file(sizes[s])) continue;
+
+        // Before: what read_history() used to build, without its line cap
+        malloc_trim(0);
+        long rss_before = rss_kb();
+        uint64_t start = bench_now_ns();
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        size_t cap = 1024, count = 0;
+        LegacyEntry *legacy = malloc(cap * sizeof(LegacyEntry));
+        char line[BUFFER_MAX_SIZE];
+        while (legacy && fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\n")] = '\0';
+            if (count == cap) {
+                cap *= 2;
+                legacy = realloc(legacy, cap * sizeof(LegacyEntry));
+                if (!legacy) break;
+            }
+            legacy[count].id = (int)count + 1;
+            legacy[count].command = strdup(line);
+            count++;
+        }
+        fclose(f);
+        if (!legacy) continue;
+        uint64_t load_ns = bench_now_ns() - start;
+        long rss = rss_kb() - rss_before;
+
+        uint64_t scan_ns = UINT64_MAX;
+        long hits = 0;
+        for (int r = 0; r < BENCH_REPS; r++) {
+            hits = 0;
+            start = bench_now_ns();
+            for (size_t i = 0; i < count; i++)
+                if (strstr(legacy[i].command, needle)) hits++;
+            uint64_t t = bench_now_ns() - start;
+            if (t < scan_ns) scan_ns = t;
+        }
+
+        start = bench_now_ns();
+        for (size_t i = 0; i < count; i++) free(legacy[i].command);
+        free(legacy);
+        uint64_t free_ns = bench_now_ns() - start;
+
+        snprintf(variant, sizeof(variant), "strdup_%ld", sizes[s]);
+        report_layout(variant, (long)count, load_ns, scan_ns, free_ns, rss, hits);
+
+        // After: the arena
+        malloc_trim(0);
+        rss_before = rss_kb();
+        start = bench_now_ns();
+        History history;
+        read_history(&history);
+        load_ns = bench_now_ns() - start;
+        rss = rss_kb() - rss_before;
+
+        scan_ns = UINT64_MAX;
+        for (int r = 0; r < BENCH_REPS; r++) {
+            hits = 0;
+            start = bench_now_ns();
+            const char *pos = history.arena, *end = history.arena + history.arena_len;
+            const char *hit;
+            while (pos < end && (hit = memmem(pos, (size_t)(end - pos), needle, needle_len)) != NULL) {
+                hits++;
+                pos = hit + needle_len;
+            }
+            uint64_t t = bench_now_ns() - start;
+            if (t < scan_ns) scan_ns = t;
+        }
+
+        start = bench_now_ns();
+        int entries = history.count;
+        free_history(&history);
+        free_ns = bench_now_ns() - start;
+
+        snprintf(variant, sizeof(variant), "arena_%ld", sizes[s]);
+        report_layout(variant, entries, load_ns, scan_ns, free_ns, rss, hits);
+    }
+}
+
+/* script */
+
+static void bench_ast_eval(void *ctx) {
+    ast_eval(ctx);
+}
+
+static void script_benches(void) {
+    run("script", "parse_compound", bench_ast_parse,
+        "for i in a b c; do if test $i = b; then echo $i; else continue; fi; done");
+
+    long sizes[8];
+    int n = read_sizes("HERMES_BENCH_LOOP_SIZES", "100000", sizes, 8);
+    for (int s = 0; s < n; s++) {
+        // for i in 1 2 ... N; do true; done, parsed once and evaluated per op
+        size_t cap = (size_t)sizes[s] * 8 + 64, len = 0;
+        char *src = malloc(cap);
+        if (!src) return;
+        len += (size_t)snprintf(src, cap, "for i in");
+        for (long i = 1; i <= sizes[s]; i++)
+            len += (size_t)snprintf(src + len, cap - len, " %ld", i);
+        snprintf(src + len, cap - len, "; do true; done");
+
+        Node *tree;
+        if (ast_parse(src, &tree) == AST_OK) {
+            char variant[64];
+            snprintf(variant, sizeof(variant), "for_true_%ld", sizes[s]);
+            run("script", variant, bench_ast_eval, tree);
+            ast_free(tree);
+        }
+        free(src);
+    }
+}
+
+/* launch */
+
+static void bench_launch(void *ctx) {
+    launch(ctx, 1);
+}
+
+static void launch_benches(void) {
+    String args[] = {{"true", 4}, {NULL, 0}};
+    run("launch", "true", bench_launch, args);
+}
+
+int main(int argc, char **argv) {
+    // launch() hands the terminal to its child; keep the bench off the tty
+    int devnull = open("/dev/null", O_RDONLY);
+    dup2(devnull, STDIN_FILENO);
+    close(devnull);
+
+    const char *tmp = getenv("TMPDIR");
+    snprintf(bench_home, sizeof(bench_home), "%s/hermes-bench-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(bench_home)) {
+        perror("bench");
+        return EXIT_FAILURE;
+    }
+    bench_isolate_env(bench_home);
+
+    // Optional filter: only run benches whose name is given
+    bool all = argc < 2;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "ast_parse") == 0) parse_benches();
+        if (strcmp(argv[i], "handle_tab") == 0) tab_benches();
+        if (strcmp(argv[i], "history") == 0) history_benches();
+        if (strcmp(argv[i], "history_layout") == 0) layout_benches();
+        if (strcmp(argv[i], "script") == 0) script_benches();
+        if (strcmp(argv[i], "launch") == 0) launch_benches();
+    }
+    if (all) {
+        parse_benches();
+        tab_benches();
+        history_benches();
+        layout_benches();
+        script_benches();
+        launch_benches();
+    }
+
+    remove_tree(bench_home);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#ifndef HERMES_BENCH_H
+#define HERMES_BENCH_H
+
+#include <stdint.h>
+#include <time.h>
+#include "globals.h"
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline int bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Value at quantile q (0..1) of an already sorted sample
+static inline uint64_t bench_quantile(const uint64_t *sorted, size_t n, double q) {
+    if (n == 0) return 0;
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+// Revision tag so results from different commits can be told apart
+static inline const char *bench_rev(void) {
+    const char *rev = getenv("HERMES_BENCH_REV");
+    return rev && *rev ? rev : "unknown";
+}
+
+/*
+ * Point the shell under test at a scratch home: with the XDG variables
+ * unset, config, data and cache all fall back to $HOME, and no user's
+ * shared history ring or trace file is touched.
+ */
+static inline void bench_isolate_env(const char *home) {
+    setenv("HOME", home, 1);
+    unsetenv("XDG_CONFIG_HOME");
+    unsetenv("XDG_DATA_HOME");
+    unsetenv("XDG_CACHE_HOME");
+    unsetenv("HERMES_SHARE_HISTORY");
+    unsetenv("HERMES_TRACE");
+}
+
+#endif
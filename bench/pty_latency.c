@@ -0,0 +1,203 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include "bench.h"
+
+/*
+ * Replays keystroke scripts into a real hermes REPL over a pseudo-terminal
+ * and records the time from each key being written to the first byte of
+ * the shell's redraw. Script lines are sent byte by byte and understand
+ * \r, \t, \e, \\ and \xNN escapes; lines starting with '#' are comments.
+ */
+
+#define MAX_SAMPLES (1 << 20)
+#define KEY_TIMEOUT_MS 2000
+#define EDIT_IDLE_MS 2      // quiet period that ends one key's redraw
+#define ENTER_IDLE_MS 50    // commands may print for a while
+
+typedef struct Samples {
+    uint64_t *ns;
+    size_t count;
+} Samples;
+
+static char bench_home[PATH_MAX];
+
+static int remove_entry(const char *path, const struct stat *sb, int flag, struct FTW *ftw) {
+    return remove(path);
+}
+
+static pid_t spawn_shell(const char *hermes, int *master_out) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return -1;
+    char *slave_name = ptsname(master);
+    if (!slave_name) return -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        int slave = open(slave_name, O_RDWR);
+        if (slave < 0) _exit(127);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        close(slave);
+        close(master);
+        bench_isolate_env(bench_home);
+        execl(hermes, hermes, (char *)NULL);
+        _exit(127);
+    }
+    *master_out = master;
+    return pid;
+}
+
+// Wait up to timeout_ms for output; returns false if none arrived
+static bool wait_output(int fd, int timeout_ms) {
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    return poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
+// Read until the shell has been quiet for idle_ms
+static void drain(int fd, int idle_ms) {
+    char buf[4096];
+    while (wait_output(fd, idle_ms)) {
+        if (read(fd, buf, sizeof(buf)) <= 0) return;
+    }
+}
+
+static size_t unescape(const char *in, char *out) {
+    size_t n = 0;
+    while (*in) {
+        if (*in != '\\' || !in[1]) {
+            out[n++] = *in++;
+            continue;
+        }
+        in++;
+        switch (*in) {
+        case 'r': out[n++] = '\r'; in++; break;
+        case 't': out[n++] = '\t'; in++; break;
+        case 'e': out[n++] = '\033'; in++; break;
+        case 'x': {
+            char hex[3] = {0};
+            in++;
+            for (int i = 0; i < 2 && *in; i++) hex[i] = *in++;
+            out[n++] = (char)strtol(hex, NULL, 16);
+            break;
+        }
+        default: out[n++] = *in++; break;
+        }
+    }
+    return n;
+}
+
+static void replay(int fd, const char *keys, size_t len, Samples *edit, Samples *enter) {
+    for (size_t i = 0; i < len; i++) {
+        bool is_enter = keys[i] == '\r';
+        // Escape sequences only redraw once complete
+        bool partial = i + 1 < len && (keys[i] == '\033' || (i > 0 && keys[i - 1] == '\033' && keys[i] == '['));
+
+        uint64_t start = bench_now_ns();
+        if (write(fd, &keys[i], 1) != 1) return;
+        if (partial) continue;
+        if (!wait_output(fd, KEY_TIMEOUT_MS)) continue;
+        uint64_t elapsed = bench_now_ns() - start;
+
+        Samples *s = is_enter ? enter : edit;
+        if (s->count < MAX_SAMPLES) s->ns[s->count++] = elapsed;
+        drain(fd, is_enter ? ENTER_IDLE_MS : EDIT_IDLE_MS);
+    }
+}
+
+static void report(const char *variant, const char *kind, Samples *s) {
+    if (s->count == 0) return;
+    qsort(s->ns, s->count, sizeof(uint64_t), bench_compare_u64);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < s->count; i++) sum += s->ns[i];
+
+    printf("{\"rev\":\"%s\",\"bench\":\"pty_latency\",\"variant\":\"%s/%s\",\"samples\":%zu,"
+           "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"mean_us\":%.1f}\n",
+           bench_rev(), variant, kind, s->count,
+           (double)bench_quantile(s->ns, s->count, 0.50) / 1e3,
+           (double)bench_quantile(s->ns, s->count, 0.90) / 1e3,
+           (double)bench_quantile(s->ns, s->count, 0.99) / 1e3,
+           (double)s->ns[s->count - 1] / 1e3,
+           (double)sum / (double)s->count / 1e3);
+    fflush(stdout);
+}
+
+static int run_script(const char *hermes, const char *script, int rounds) {
+    FILE *f = fopen(script, "r");
+    if (!f) {
+        fprintf(stderr, "pty-latency: %s: %s\n", script, strerror(errno));
+        return -1;
+    }
+
+    size_t cap = 4096, len = 0;
+    char *keys = malloc(cap);
+    char line[BUFFER_MAX_SIZE];
+    while (keys && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+        if (len + strlen(line) + 1 > cap) {
+            cap = (len + strlen(line) + 1) * 2;
+            keys = realloc(keys, cap);
+            if (!keys) break;
+        }
+        len += unescape(line, keys + len);
+    }
+    fclose(f);
+    if (!keys) return -1;
+
+    int fd;
+    pid_t pid = spawn_shell(hermes, &fd);
+    if (pid < 0) {
+        perror("pty-latency");
+        free(keys);
+        return -1;
+    }
+    drain(fd, 200);    // startup and first prompt
+
+    Samples edit = {.ns = malloc(MAX_SAMPLES * sizeof(uint64_t))};
+    Samples enter = {.ns = malloc(MAX_SAMPLES * sizeof(uint64_t))};
+    if (edit.ns && enter.ns)
+        for (int r = 0; r < rounds; r++) replay(fd, keys, len, &edit, &enter);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    close(fd);
+
+    const char *base = strrchr(script, '/');
+    base = base ? base + 1 : script;
+    report(base, "edit", &edit);
+    report(base, "enter", &enter);
+
+    free(edit.ns);
+    free(enter.ns);
+    free(keys);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <hermes> <script.keys>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *r = getenv("HERMES_BENCH_ROUNDS");
+    int rounds = r && atoi(r) > 0 ? atoi(r) : 20;
+
+    const char *tmp = getenv("TMPDIR");
+    snprintf(bench_home, sizeof(bench_home), "%s/hermes-pty-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(bench_home)) {
+        perror("pty-latency");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int i = 2; i < argc; i++)
+        if (run_script(argv[1], argv[i], rounds) < 0) status = EXIT_FAILURE;
+
+    nftw(bench_home, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return status;
+}
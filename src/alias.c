@@ -0,0 +1,181 @@
+#include "alias.h"
+#include "ast.h"
+#include "builtins.h"
+#include "map.h"
+
+struct Alias {
+    char *value;        // as defined, for listing
+    Node *command;      // value parsed once like typed input; NULL if empty
+    int refs;           // the table's reference plus one per running expansion
+};
+
+static Map aliases = {0};
+
+static void alias_release(Alias *alias) {
+    if (!alias || --alias->refs > 0) return;
+    ast_free(alias->command);
+    free(alias->value);
+    free(alias);
+}
+
+static bool valid_alias_name(const char *s) {
+    return *s && !strpbrk(s, "/=$ \t'\"\\");
+}
+
+bool alias_define(const char *alias_name, const char *value) {
+    if (!valid_alias_name(alias_name)) {
+        fprintf(stderr, "alias: %s: invalid alias name\n", alias_name);
+        return false;
+    }
+
+    // Quotes, $vars and globs mean the same as on the command line; lists
+    // and compound commands would need the evaluator, so they are refused
+    Node *command;
+    switch (ast_parse(value, &command)) {
+    case AST_OK:
+        break;
+    case AST_INCOMPLETE:
+        fprintf(stderr, "alias: %s: unexpected end of value\n", alias_name);
+        return false;
+    case AST_ERROR:
+        fprintf(stderr, "alias: %s: %s\n", alias_name, ast_error());
+        return false;
+    }
+    if (command && command->kind != NODE_COMMAND) {
+        fprintf(stderr, "alias: %s: value must be a simple command (no ;, && or ||)\n", alias_name);
+        ast_free(command);
+        return false;
+    }
+
+    Alias *alias = calloc(1, sizeof(Alias));
+    if (alias) {
+        alias->refs = 1;
+        alias->command = command;
+        alias->value = strdup(value);
+    }
+    if (!alias || !alias->value) {
+        if (alias) alias_release(alias);
+        else ast_free(command);
+        perror("alias");
+        return false;
+    }
+
+    alias_release(map_put(&aliases, alias_name, alias));
+    return true;
+}
+
+Alias *alias_begin(String *args, int argc, String **out, int *out_argc) {
+    if (aliases.count == 0) return NULL;
+    Alias *alias = map_get(&aliases, args[0].chars);
+    // A busy alias is not expanded again, so alias ls='ls -F' and loops terminate
+    if (!alias || alias->refs > 1) return NULL;
+
+    alias->refs++;
+    *out = ast_expand(alias->command, args + 1, argc - 1, out_argc);
+    return alias;
+}
+
+void alias_end(Alias *alias, String *out) {
+    free(out);
+    alias_release(alias);
+}
+
+// "name=value" or "name='value'"
+static bool define_assignment(const char *text, bool unquote) {
+    const char *eq = strchr(text, '=');
+    if (!eq || eq == text) {
+        fprintf(stderr, "alias: expected name=value, got %s\n", text);
+        return false;
+    }
+
+    char *alias_name = strndup(text, (size_t)(eq - text));
+    char *value = strdup(eq + 1);
+    bool ok = alias_name && value;
+    if (ok && unquote) {
+        size_t len = strlen(value);
+        if (len >= 2 && (value[0] == '\'' || value[0] == '"') && value[len - 1] == value[0]) {
+            memmove(value, value + 1, len - 2);
+            value[len - 2] = '\0';
+        }
+    }
+    ok = ok && alias_define(alias_name, value);
+    free(alias_name);
+    free(value);
+    return ok;
+}
+
+bool alias_config(const char *line) {
+    if (strncmp(line, "alias ", 6) != 0) return false;
+    define_assignment(line + 6 + strspn(line + 6, " \t"), true);
+    return true;
+}
+
+static void collect_name(const char *key, void *value, void *ctx) {
+    const char ***next = ctx;
+    *(*next)++ = key;
+}
+
+static int compare_alias_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void print_alias(const char *alias_name) {
+    const Alias *alias = map_get(&aliases, alias_name);
+    printf("alias %s='%s'\n", alias_name, alias->value);
+}
+
+// alias [name[=value]...]
+int builtin_alias(String *args) {
+    if (!args[1].chars) {
+        const char **names = malloc((aliases.count + 1) * sizeof(char *));
+        if (!names) return HERMES_FAILURE;
+        const char **next = names;
+        map_each(&aliases, collect_name, &next);
+        qsort(names, aliases.count, sizeof(char *), compare_alias_names);
+        for (int i = 0; i < aliases.count; i++) print_alias(names[i]);
+        free(names);
+        fflush(stdout);
+        return HERMES_SUCCESS;
+    }
+
+    int result = HERMES_SUCCESS;
+    for (int i = 1; args[i].chars; i++) {
+        if (strchr(args[i].chars, '=')) {
+            if (!define_assignment(args[i].chars, false)) result = HERMES_FAILURE;
+        } else if (map_get(&aliases, args[i].chars)) {
+            print_alias(args[i].chars);
+        } else {
+            fprintf(stderr, "alias: %s: not found\n", args[i].chars);
+            result = HERMES_FAILURE;
+        }
+    }
+    fflush(stdout);
+    return result;
+}
+
+static void release_value(void *value) {
+    alias_release(value);
+}
+
+// unalias -a | unalias name...
+int builtin_unalias(String *args) {
+    if (!args[1].chars) {
+        fprintf(stderr, "unalias: usage: unalias [-a] name...\n");
+        return HERMES_FAILURE;
+    }
+    if (strcmp(args[1].chars, "-a") == 0) {
+        map_clear(&aliases, release_value);
+        return HERMES_SUCCESS;
+    }
+
+    int result = HERMES_SUCCESS;
+    for (int i = 1; args[i].chars; i++) {
+        Alias *alias = map_remove(&aliases, args[i].chars);
+        if (!alias) {
+            fprintf(stderr, "unalias: %s: not found\n", args[i].chars);
+            result = HERMES_FAILURE;
+        }
+        alias_release(alias);
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+#ifndef HERMES_ALIAS_H
+#define HERMES_ALIAS_H
+
+#include "globals.h"
+
+typedef struct Alias Alias;
+
+// Define or replace an alias; the value is parsed as a simple command right away
+bool alias_define(const char *alias_name, const char *value);
+
+/*
+ * If args[0] names an alias that is not already being expanded, expand its
+ * words in front of the remaining arguments into *out and return the alias,
+ * which stays marked busy until alias_end(). Returns NULL otherwise.
+ */
+Alias *alias_begin(String *args, int argc, String **out, int *out_argc);
+void alias_end(Alias *alias, String *out);
+
+// Config line "alias name=value", with optional quotes around value
+bool alias_config(const char *line);
+
+#endif
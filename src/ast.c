@@ -0,0 +1,821 @@
+#include "ast.h"
+#include "map.h"
+
+#define FUNCTION_MAX_DEPTH 256
+#define ARGS_INLINE 16
+
+int execute(String *args, int argc);
+
+static void *checked(void *p) {
+    if (!p) {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static bool valid_name(const char *s) {
+    if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))) return false;
+    for (s++; *s; s++)
+        if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9')))
+            return false;
+    return true;
+}
+
+/* Lexer */
+
+typedef enum TokenKind {
+    TOK_WORD,
+    TOK_SEMI,
+    TOK_NEWLINE,
+    TOK_AND,
+    TOK_OR,
+    TOK_LPAREN,
+    TOK_RPAREN,
+    TOK_END,
+} TokenKind;
+
+typedef struct Parser {
+    const char *src;
+    size_t pos;
+    TokenKind kind;         // current token
+    char *word;             // TOK_WORD text, owned by the parser until taken
+    bool quoted;            // part of the word was quoted or escaped
+    AstStatus status;
+} Parser;
+
+typedef struct Buffer {
+    char *chars;
+    size_t len, cap;
+} Buffer;
+
+static void buffer_push(Buffer *b, char c) {
+    if (b->len + 1 >= b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 32;
+        b->chars = checked(realloc(b->chars, b->cap));
+    }
+    b->chars[b->len++] = c;
+    b->chars[b->len] = '\0';
+}
+
+// Lone & and | stay part of words, as they always have
+static bool at_operator(const char *s) {
+    return *s == ';' || *s == '\n' || *s == '(' || *s == ')' ||
+           (s[0] == '&' && s[1] == '&') || (s[0] == '|' && s[1] == '|');
+}
+
+static void next(Parser *p) {
+    free(p->word);
+    p->word = NULL;
+    p->quoted = false;
+    p->kind = TOK_END;
+    if (p->status != AST_OK) return;
+
+    const char *s = p->src;
+    size_t i = p->pos;
+    while (s[i] == ' ' || s[i] == '\t') i++;
+    if (s[i] == '#')
+        while (s[i] && s[i] != '\n') i++;
+
+    switch (s[i]) {
+    case '\0': p->pos = i; return;
+    case ';': p->kind = TOK_SEMI; p->pos = i + 1; return;
+    case '\n': p->kind = TOK_NEWLINE; p->pos = i + 1; return;
+    case '(': p->kind = TOK_LPAREN; p->pos = i + 1; return;
+    case ')': p->kind = TOK_RPAREN; p->pos = i + 1; return;
+    }
+    if (at_operator(&s[i])) {
+        p->kind = s[i] == '&' ? TOK_AND : TOK_OR;
+        p->pos = i + 2;
+        return;
+    }
+
+    // Quotes and backslashes make the whole word literal
+    Buffer word = {0};
+    while (s[i] && s[i] != ' ' && s[i] != '\t' && !at_operator(&s[i])) {
+        if (s[i] == '\\') {
+            if (!s[i + 1]) goto incomplete;
+            if (s[i + 1] != '\n') buffer_push(&word, s[i + 1]);
+            p->quoted = true;
+            i += 2;
+        } else if (s[i] == '\'' || s[i] == '"') {
+            char quote = s[i++];
+            while (s[i] != quote) {
+                if (!s[i]) goto incomplete;
+                if (quote == '"' && s[i] == '\\' && (s[i + 1] == '"' || s[i + 1] == '\\')) i++;
+                buffer_push(&word, s[i++]);
+            }
+            i++;
+            p->quoted = true;
+        } else {
+            buffer_push(&word, s[i++]);
+        }
+    }
+    p->kind = TOK_WORD;
+    p->word = word.chars ? word.chars : checked(strdup(""));
+    p->pos = i;
+    return;
+
+incomplete:
+    free(word.chars);
+    p->status = AST_INCOMPLETE;
+}
+
+static char *take(Parser *p) {
+    char *word = p->word;
+    p->word = NULL;
+    return word;
+}
+
+static char error_text[128];
+
+static void syntax_error(Parser *p) {
+    static const char *tokens[] = {
+        [TOK_SEMI] = ";", [TOK_NEWLINE] = "newline", [TOK_AND] = "&&", [TOK_OR] = "||",
+        [TOK_LPAREN] = "(", [TOK_RPAREN] = ")", [TOK_END] = "end of input",
+    };
+    if (p->status != AST_OK) return;
+    snprintf(error_text, sizeof(error_text), "syntax error near `%s'",
+             p->kind == TOK_WORD ? p->word : tokens[p->kind]);
+    p->status = AST_ERROR;
+}
+
+// At the end of input more lines can still complete the construct
+static void unexpected(Parser *p) {
+    if (p->kind == TOK_END) {
+        if (p->status == AST_OK) p->status = AST_INCOMPLETE;
+    } else {
+        syntax_error(p);
+    }
+}
+
+static bool at_keyword(const Parser *p, const char *keyword) {
+    return p->kind == TOK_WORD && !p->quoted && strcmp(p->word, keyword) == 0;
+}
+
+// Reserved words that end the list before them
+static bool at_closer(const Parser *p) {
+    static const char *closers[] = {"then", "elif", "else", "fi", "do", "done", "}"};
+    for (size_t i = 0; i < sizeof(closers) / sizeof(closers[0]); i++)
+        if (at_keyword(p, closers[i])) return true;
+    return false;
+}
+
+static bool expect(Parser *p, const char *keyword) {
+    if (at_keyword(p, keyword)) {
+        next(p);
+        return true;
+    }
+    unexpected(p);
+    return false;
+}
+
+// Newlines and semicolons are interchangeable wherever a list may continue
+static void skip_separators(Parser *p) {
+    while (p->kind == TOK_SEMI || p->kind == TOK_NEWLINE)
+        next(p);
+}
+
+/* Parser */
+
+static Node *new_node(NodeKind kind) {
+    Node *node = checked(calloc(1, sizeof(Node)));
+    node->kind = kind;
+    node->refs = 1;
+    return node;
+}
+
+static Word make_word(char *text, bool quoted) {
+    Word w = {.kind = WORD_LITERAL, .text = {.chars = text, .len = (int)strlen(text)}};
+    if (quoted) return w;
+
+    if (text[0] == '$' && text[1]) {
+        const char *v = text + 1;
+        if (strcmp(v, "?") == 0) {
+            w.kind = WORD_STATUS;
+        } else if (strcmp(v, "#") == 0) {
+            w.kind = WORD_PARAM_COUNT;
+        } else if (strcmp(v, "@") == 0 || strcmp(v, "*") == 0) {
+            w.kind = WORD_PARAMS;
+        } else if (strspn(v, "0123456789") == strlen(v)) {
+            w.kind = WORD_PARAM;
+            w.param = atoi(v);
+        } else {
+            w.kind = WORD_VAR;
+            memmove(text, v, strlen(v) + 1);
+            w.text.len--;
+        }
+    } else if (glob_has_magic(text) && (w.glob = glob_compile(text))) {
+        w.kind = WORD_GLOB;
+    }
+    return w;
+}
+
+static void push_word(Word **words, int *count, int *cap, Word w) {
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 4;
+        *words = checked(realloc(*words, *cap * sizeof(Word)));
+    }
+    (*words)[(*count)++] = w;
+}
+
+static void free_words(Word *words, int count) {
+    for (int i = 0; i < count; i++) {
+        free(words[i].text.chars);
+        if (words[i].glob) glob_pattern_free(words[i].glob);
+    }
+    free(words);
+}
+
+static void list_push(Node *list, Node *item) {
+    if (list->list.count == list->list.cap) {
+        list->list.cap = list->list.cap ? list->list.cap * 2 : 4;
+        list->list.items = checked(realloc(list->list.items, list->list.cap * sizeof(Node *)));
+    }
+    list->list.items[list->list.count++] = item;
+}
+
+static Node *parse_list(Parser *p);
+static Node *parse_command(Parser *p);
+
+static Node *parse_simple(Parser *p) {
+    Word *words = NULL;
+    int count = 0, cap = 0;
+    while (p->kind == TOK_WORD) {
+        bool quoted = p->quoted;
+        push_word(&words, &count, &cap, make_word(take(p), quoted));
+        next(p);
+    }
+
+    // name() body
+    if (p->kind == TOK_LPAREN) {
+        if (count != 1 || words[0].kind != WORD_LITERAL || !valid_name(words[0].text.chars)) {
+            syntax_error(p);
+            free_words(words, count);
+            return NULL;
+        }
+        next(p);
+        if (p->kind != TOK_RPAREN) {
+            unexpected(p);
+            free_words(words, count);
+            return NULL;
+        }
+        next(p);
+        skip_separators(p);
+
+        Node *node = new_node(NODE_FUNCTION);
+        node->function.name = words[0].text.chars;
+        free(words);
+        node->function.body = parse_command(p);
+        if (!node->function.body) {
+            ast_free(node);
+            return NULL;
+        }
+        return node;
+    }
+
+    Node *node = new_node(NODE_COMMAND);
+    node->command.words = words;
+    node->command.count = count;
+    return node;
+}
+
+static Node *parse_if(Parser *p) {
+    next(p);    // if or elif
+    Node *node = new_node(NODE_IF);
+    if (!(node->branch.cond = parse_list(p)) || !expect(p, "then") ||
+        !(node->branch.then_part = parse_list(p)))
+        goto fail;
+
+    // elif is a nested if that shares this one's fi
+    if (at_keyword(p, "elif")) {
+        if (!(node->branch.else_part = parse_if(p))) goto fail;
+        return node;
+    }
+    if (at_keyword(p, "else")) {
+        next(p);
+        if (!(node->branch.else_part = parse_list(p))) goto fail;
+    }
+    if (!expect(p, "fi")) goto fail;
+    return node;
+
+fail:
+    ast_free(node);
+    return NULL;
+}
+
+static Node *parse_loop(Parser *p) {
+    Node *node = new_node(NODE_WHILE);
+    node->loop.until = at_keyword(p, "until");
+    next(p);
+    if (!(node->loop.cond = parse_list(p)) || !expect(p, "do") ||
+        !(node->loop.body = parse_list(p)) || !expect(p, "done")) {
+        ast_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+static Node *parse_for(Parser *p) {
+    next(p);
+    if (p->kind != TOK_WORD || p->quoted || !valid_name(p->word)) {
+        unexpected(p);
+        return NULL;
+    }
+    Node *node = new_node(NODE_FOR);
+    node->each.var = take(p);
+    next(p);
+    skip_separators(p);
+
+    // Without "in" the loop walks the positional parameters
+    if (at_keyword(p, "in")) {
+        node->each.has_in = true;
+        next(p);
+        int cap = 0;
+        while (p->kind == TOK_WORD) {
+            bool quoted = p->quoted;
+            push_word(&node->each.words, &node->each.count, &cap, make_word(take(p), quoted));
+            next(p);
+        }
+        skip_separators(p);
+    }
+
+    if (!expect(p, "do") || !(node->each.body = parse_list(p)) || !expect(p, "done")) {
+        ast_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+static Node *parse_group(Parser *p) {
+    next(p);
+    Node *list = parse_list(p);
+    if (list && !expect(p, "}")) {
+        ast_free(list);
+        return NULL;
+    }
+    return list;
+}
+
+static Node *parse_command(Parser *p) {
+    if (p->kind != TOK_WORD || at_closer(p)) {
+        unexpected(p);
+        return NULL;
+    }
+    if (at_keyword(p, "if")) return parse_if(p);
+    if (at_keyword(p, "while") || at_keyword(p, "until")) return parse_loop(p);
+    if (at_keyword(p, "for")) return parse_for(p);
+    if (at_keyword(p, "{")) return parse_group(p);
+    return parse_simple(p);
+}
+
+static Node *parse_not(Parser *p) {
+    if (!at_keyword(p, "!")) return parse_command(p);
+    next(p);
+    Node *child = parse_not(p);
+    if (!child) return NULL;
+    Node *node = new_node(NODE_NOT);
+    node->binary.left = child;
+    return node;
+}
+
+static Node *parse_and_or(Parser *p) {
+    Node *left = parse_not(p);
+    while (left && (p->kind == TOK_AND || p->kind == TOK_OR)) {
+        Node *node = new_node(p->kind == TOK_AND ? NODE_AND : NODE_OR);
+        node->binary.left = left;
+        next(p);
+        skip_separators(p);
+        if (!(node->binary.right = parse_not(p))) {
+            ast_free(node);
+            return NULL;
+        }
+        left = node;
+    }
+    return left;
+}
+
+// Commands up to the end of input or a closing reserved word
+static Node *parse_list(Parser *p) {
+    Node *list = new_node(NODE_LIST);
+    for (;;) {
+        skip_separators(p);
+        if (p->kind == TOK_END || p->kind == TOK_RPAREN || at_closer(p)) break;
+
+        Node *item = parse_and_or(p);
+        if (!item) break;
+        list_push(list, item);
+        if (p->kind != TOK_SEMI && p->kind != TOK_NEWLINE && p->kind != TOK_END && !at_closer(p)) {
+            syntax_error(p);
+            break;
+        }
+    }
+
+    if (p->status != AST_OK) {
+        ast_free(list);
+        return NULL;
+    }
+    if (list->list.count == 1) {
+        Node *only = list->list.items[0];
+        list->list.count = 0;
+        ast_free(list);
+        return only;
+    }
+    return list;
+}
+
+AstStatus ast_parse(const char *src, Node **out) {
+    Parser p = {.src = src};
+    next(&p);
+    Node *tree = parse_list(&p);
+    if (tree && p.kind != TOK_END) {
+        syntax_error(&p);    // stray closer or )
+        ast_free(tree);
+        tree = NULL;
+    }
+    free(p.word);
+
+    if (p.status != AST_OK) {
+        *out = NULL;
+        return p.status;
+    }
+    if (tree->kind == NODE_LIST && tree->list.count == 0) {
+        ast_free(tree);
+        tree = NULL;
+    }
+    *out = tree;
+    return AST_OK;
+}
+
+const char *ast_error(void) {
+    return error_text;
+}
+
+void ast_free(Node *node) {
+    if (!node || --node->refs > 0) return;
+
+    switch (node->kind) {
+    case NODE_COMMAND:
+        free_words(node->command.words, node->command.count);
+        break;
+    case NODE_LIST:
+        for (int i = 0; i < node->list.count; i++)
+            ast_free(node->list.items[i]);
+        free(node->list.items);
+        break;
+    case NODE_AND:
+    case NODE_OR:
+    case NODE_NOT:
+        ast_free(node->binary.left);
+        ast_free(node->binary.right);
+        break;
+    case NODE_IF:
+        ast_free(node->branch.cond);
+        ast_free(node->branch.then_part);
+        ast_free(node->branch.else_part);
+        break;
+    case NODE_WHILE:
+        ast_free(node->loop.cond);
+        ast_free(node->loop.body);
+        break;
+    case NODE_FOR:
+        free(node->each.var);
+        free_words(node->each.words, node->each.count);
+        ast_free(node->each.body);
+        break;
+    case NODE_FUNCTION:
+        free(node->function.name);
+        ast_free(node->function.body);
+        break;
+    }
+    free(node);
+}
+
+/* Evaluator */
+
+typedef struct Frame {
+    char **params;          // $1..$N, owned by the frame
+    int count;
+    char count_text[12];    // $#
+} Frame;
+
+typedef struct Args {
+    String *items;          // NULL-terminated, like execute() expects
+    int count, cap;
+    String inline_items[ARGS_INLINE];
+} Args;
+
+static Map functions = {0};
+static Map loop_vars = {0};     // for variables while their loop runs
+static Frame top_frame = {.count_text = "0"};
+static Frame *frame = &top_frame;
+static int call_depth = 0;
+static int loop_depth = 0;
+static int breaking = 0;        // loop levels break still has to leave
+static int continuing = 0;      // loop levels continue still has to leave
+static bool returning = false;
+static int last_status = 0;
+static char status_text[12] = "0";
+static volatile sig_atomic_t interrupted = 0;
+
+#define UNWINDING() (breaking || continuing || returning || interrupted)
+
+void ast_interrupt(void) {
+    interrupted = 1;
+}
+
+static void args_init(Args *args) {
+    args->items = args->inline_items;
+    args->count = 0;
+    args->cap = ARGS_INLINE;
+    args->items[0] = (String){0};
+}
+
+static void args_push(Args *args, char *chars, int len) {
+    if (args->count + 1 == args->cap) {
+        args->cap *= 2;
+        if (args->items == args->inline_items) {
+            args->items = checked(malloc(args->cap * sizeof(String)));
+            memcpy(args->items, args->inline_items, sizeof(args->inline_items));
+        } else {
+            args->items = checked(realloc(args->items, args->cap * sizeof(String)));
+        }
+    }
+    args->items[args->count++] = (String){.chars = chars, .len = len};
+    args->items[args->count] = (String){0};
+}
+
+static void args_free(Args *args) {
+    if (args->items != args->inline_items) free(args->items);
+}
+
+static void expand(const Word *words, int count, Args *args) {
+    for (int i = 0; i < count; i++) {
+        const Word *w = &words[i];
+        switch (w->kind) {
+        case WORD_LITERAL:
+            args_push(args, w->text.chars, w->text.len);
+            break;
+        case WORD_VAR: {
+            char *value = loop_vars.count ? map_get(&loop_vars, w->text.chars) : NULL;
+            if (!value) value = getenv(w->text.chars);
+            if (value) args_push(args, value, (int)strlen(value));
+            break;
+        }
+        case WORD_STATUS:
+            snprintf(status_text, sizeof(status_text), "%d", last_status);
+            args_push(args, status_text, (int)strlen(status_text));
+            break;
+        case WORD_PARAM:
+            if (w->param == 0)
+                args_push(args, (char *)name, (int)strlen(name));
+            else if (w->param <= frame->count)
+                args_push(args, frame->params[w->param - 1], (int)strlen(frame->params[w->param - 1]));
+            break;
+        case WORD_PARAM_COUNT:
+            args_push(args, frame->count_text, (int)strlen(frame->count_text));
+            break;
+        case WORD_PARAMS:
+            for (int p = 0; p < frame->count; p++)
+                args_push(args, frame->params[p], (int)strlen(frame->params[p]));
+            break;
+        case WORD_GLOB: {
+            char **matches;
+            int n = glob_expand(w->glob, &matches);
+            for (int m = 0; m < n; m++)
+                args_push(args, matches[m], (int)strlen(matches[m]));
+            if (n == 0) args_push(args, w->text.chars, w->text.len);
+            break;
+        }
+        }
+    }
+}
+
+// break, continue and return steer the evaluator itself, so they are
+// handled here rather than as builtins
+static bool control(const Args *args, int *status) {
+    const char *cmd = args->items[0].chars;
+    bool is_return = strcmp(cmd, "return") == 0;
+    if (!is_return && strcmp(cmd, "break") != 0 && strcmp(cmd, "continue") != 0) return false;
+
+    long n = is_return ? last_status : 1;
+    if (args->count > 1) {
+        char *end;
+        n = strtol(args->items[1].chars, &end, 10);
+        if (*end || n < (is_return ? 0 : 1)) {
+            fprintf(stderr, "%s: %s: numeric argument required\n", cmd, args->items[1].chars);
+            *status = 2;
+            return true;
+        }
+    }
+
+    if (is_return) {
+        if (call_depth == 0) {
+            fprintf(stderr, "return: can only return from a function\n");
+            *status = 1;
+            return true;
+        }
+        returning = true;
+        *status = (int)(n & 255);
+        return true;
+    }
+
+    if (loop_depth == 0) {
+        fprintf(stderr, "%s: only meaningful in a loop\n", cmd);
+        *status = 1;
+        return true;
+    }
+    if (n > loop_depth) n = loop_depth;
+    if (cmd[0] == 'b') breaking = (int)n;
+    else continuing = (int)n;
+    *status = 0;
+    return true;
+}
+
+static int eval(Node *node);
+
+static int eval_command(Node *node) {
+    Args args;
+    args_init(&args);
+    // glob results of the previous command are no longer referenced
+    glob_reset();
+    expand(node->command.words, node->command.count, &args);
+
+    int status = 0;
+    if (args.count > 0 && !control(&args, &status))
+        status = execute(args.items, args.count);
+    args_free(&args);
+    return status;
+}
+
+// After a loop body or condition ran: true if the loop has to stop
+static bool leave_loop(void) {
+    if (breaking) {
+        breaking--;
+        return true;
+    }
+    if (continuing) {
+        continuing--;
+        return continuing > 0;
+    }
+    return returning || interrupted;
+}
+
+static int eval_while(Node *node) {
+    int status = 0;
+    loop_depth++;
+    while (!interrupted) {
+        int cond = eval(node->loop.cond);
+        if (UNWINDING()) {
+            if (leave_loop()) break;
+            continue;
+        }
+        if ((cond == 0) == node->loop.until) break;
+        status = eval(node->loop.body);
+        if (UNWINDING() && leave_loop()) break;
+    }
+    loop_depth--;
+    return status;
+}
+
+static int eval_for(Node *node) {
+    Args items;
+    args_init(&items);
+    glob_reset();
+    if (node->each.has_in) {
+        expand(node->each.words, node->each.count, &items);
+    } else {
+        for (int p = 0; p < frame->count; p++)
+            args_push(&items, frame->params[p], 0);
+    }
+
+    // The body's own commands reset glob storage and may rewrite the
+    // environment, so the expanded list is copied once up front
+    char **values = checked(malloc((items.count + 1) * sizeof(char *)));
+    for (int i = 0; i < items.count; i++)
+        values[i] = checked(strdup(items.items[i].chars));
+    int count = items.count;
+    args_free(&items);
+
+    // Iterations only rebind the variable in the evaluator; the environment
+    // sees the final value once the loop is over
+    char *outer = map_get(&loop_vars, node->each.var);
+    int status = 0, last = -1;
+    loop_depth++;
+    for (int i = 0; i < count && !interrupted; i++) {
+        map_put(&loop_vars, node->each.var, values[i]);
+        last = i;
+        status = eval(node->each.body);
+        if (UNWINDING() && leave_loop()) break;
+    }
+    loop_depth--;
+
+    if (outer) map_put(&loop_vars, node->each.var, outer);
+    else map_remove(&loop_vars, node->each.var);
+    if (last >= 0) setenv(node->each.var, values[last], true);
+
+    for (int i = 0; i < count; i++) free(values[i]);
+    free(values);
+    return status;
+}
+
+static int eval(Node *node) {
+    int status = 0;
+    switch (node->kind) {
+    case NODE_COMMAND:
+        status = eval_command(node);
+        break;
+    case NODE_LIST:
+        for (int i = 0; i < node->list.count && !UNWINDING(); i++)
+            status = eval(node->list.items[i]);
+        break;
+    case NODE_AND:
+        status = eval(node->binary.left);
+        if (status == 0 && !UNWINDING()) status = eval(node->binary.right);
+        break;
+    case NODE_OR:
+        status = eval(node->binary.left);
+        if (status != 0 && !UNWINDING()) status = eval(node->binary.right);
+        break;
+    case NODE_NOT:
+        status = eval(node->binary.left) == 0;
+        break;
+    case NODE_IF:
+        status = eval(node->branch.cond);
+        if (UNWINDING()) break;
+        if (status == 0) status = eval(node->branch.then_part);
+        else status = node->branch.else_part ? eval(node->branch.else_part) : 0;
+        break;
+    case NODE_WHILE:
+        status = eval_while(node);
+        break;
+    case NODE_FOR:
+        status = eval_for(node);
+        break;
+    case NODE_FUNCTION:
+        // The body stays parsed; calls evaluate it directly
+        node->function.body->refs++;
+        ast_free(map_put(&functions, node->function.name, node->function.body));
+        break;
+    }
+    last_status = status;
+    return status;
+}
+
+int ast_eval(Node *tree) {
+    interrupted = 0;
+    breaking = continuing = 0;
+    return tree ? eval(tree) : last_status;
+}
+
+String *ast_expand(const Node *command, const String *rest, int rest_count, int *argc) {
+    Args args;
+    args_init(&args);
+    if (command) expand(command->command.words, command->command.count, &args);
+    for (int i = 0; i < rest_count; i++)
+        args_push(&args, rest[i].chars, rest[i].len);
+
+    String *out = args.items;
+    if (out == args.inline_items) {
+        out = checked(malloc((args.count + 1) * sizeof(String)));
+        memcpy(out, args.items, (args.count + 1) * sizeof(String));
+    }
+    *argc = args.count;
+    return out;
+}
+
+bool ast_call(String *args, int argc, int *status) {
+    Node *body = map_get(&functions, args[0].chars);
+    if (!body) return false;
+    if (call_depth >= FUNCTION_MAX_DEPTH) {
+        fprintf(stderr, "%s: maximum function nesting level exceeded\n", args[0].chars);
+        *status = 1;
+        return true;
+    }
+
+    // Arguments may point into glob storage that the body's commands reset
+    Frame call = {.count = argc - 1};
+    call.params = checked(malloc(argc * sizeof(char *)));
+    for (int i = 1; i < argc; i++)
+        call.params[i - 1] = checked(strdup(args[i].chars));
+    snprintf(call.count_text, sizeof(call.count_text), "%d", call.count);
+
+    Frame *caller = frame;
+    int caller_loops = loop_depth;
+    frame = &call;
+    loop_depth = 0;
+    call_depth++;
+    body->refs++;   // the body may redefine its own function
+
+    *status = eval(body);
+
+    ast_free(body);
+    call_depth--;
+    loop_depth = caller_loops;
+    frame = caller;
+    returning = false;
+
+    for (int i = 0; i < call.count; i++) free(call.params[i]);
+    free(call.params);
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef HERMES_AST_H
+#define HERMES_AST_H
+
+#include "globals.h"
+#include "glob.h"
+
+/*
+ * Command lines are parsed once into a tree and then evaluated, so loop
+ * bodies and function bodies never go back through the tokenizer. Words
+ * are classified at parse time: literals are used as-is, and only $vars,
+ * positional parameters and glob patterns do any work per evaluation.
+ */
+
+typedef enum WordKind {
+    WORD_LITERAL,
+    WORD_VAR,           // $NAME, from the environment
+    WORD_STATUS,        // $?
+    WORD_PARAM,         // $0..$N
+    WORD_PARAM_COUNT,   // $#
+    WORD_PARAMS,        // $@ and $*, one word per parameter
+    WORD_GLOB,          // unquoted word with *, ? or [
+} WordKind;
+
+typedef struct Word {
+    WordKind kind;
+    String text;            // literal text, variable name or glob source
+    int param;              // WORD_PARAM index
+    GlobPattern *glob;      // WORD_GLOB, compiled once
+} Word;
+
+typedef enum NodeKind {
+    NODE_COMMAND,
+    NODE_LIST,          // a; b; c
+    NODE_AND,           // a && b
+    NODE_OR,            // a || b
+    NODE_NOT,           // ! a
+    NODE_IF,
+    NODE_WHILE,         // also until
+    NODE_FOR,
+    NODE_FUNCTION,      // name() body
+} NodeKind;
+
+typedef struct Node {
+    NodeKind kind;
+    int refs;           // function bodies are shared with the function table
+    union {
+        struct { Word *words; int count; } command;
+        struct { struct Node **items; int count, cap; } list;
+        struct { struct Node *left, *right; } binary;
+        struct { struct Node *cond, *then_part, *else_part; } branch;
+        struct { struct Node *cond, *body; bool until; } loop;
+        struct { char *var; Word *words; int count; bool has_in; struct Node *body; } each;
+        struct { char *name; struct Node *body; } function;
+    };
+} Node;
+
+typedef enum AstStatus {
+    AST_OK,
+    AST_INCOMPLETE,     // input ended inside a construct; read another line
+    AST_ERROR,          // syntax error, see ast_error()
+} AstStatus;
+
+// Parse a complete command line; *out is NULL for empty input
+AstStatus ast_parse(const char *src, Node **out);
+
+// Description of the last AST_ERROR
+const char *ast_error(void);
+
+// Evaluate a parsed tree; returns the exit status $? reports afterwards
+int ast_eval(Node *tree);
+
+void ast_free(Node *node);
+
+/*
+ * Expand a simple command's words the way eval would, followed by rest;
+ * the NULL-terminated array is malloc'd, its strings are borrowed.
+ */
+String *ast_expand(const Node *command, const String *rest, int rest_count, int *argc);
+
+// Run a shell function if one named args[0] is defined
+bool ast_call(String *args, int argc, int *status);
+
+// Abort running loops; async-signal-safe, called from the SIGINT handler
+void ast_interrupt(void);
+
+#endif
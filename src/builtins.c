@@ -1,4 +1,5 @@
 #include "builtins.h"
+#include "frecency.h"
 
 char *builtin_str[] = {
     "cd",
@@ -8,10 +9,26 @@ char *builtin_str[] = {
     "help",
     "clear",
     "fish",
-    "history"};
+    "history",
+    "times",
+    "laststat",
+    "parallel",
+    "z",
+    "ulimit",
+    "true",
+    "false",
+    "alias",
+    "unalias"};
 
 const int builtin_str_count = sizeof(builtin_str) / sizeof(char *);
 
+// Dispatched by execute_with() since they run another command, listed here for help and TAB
+char *prefix_str[] = {
+    "with",
+    "cache"};
+
+const int prefix_str_count = sizeof(prefix_str) / sizeof(char *);
+
 builtin_function builtin_func[] = {
     &builtin_cd,
     &builtin_exit,
@@ -20,12 +37,37 @@ builtin_function builtin_func[] = {
     &builtin_help,
     &builtin_clear,
     &builtin_fish,
-    &builtin_history
+    &builtin_history,
+    &builtin_times,
+    &builtin_laststat,
+    &builtin_parallel,
+    &builtin_z,
+    &builtin_ulimit,
+    &builtin_true,
+    &builtin_false,
+    &builtin_alias,
+    &builtin_unalias
 };
 
+// export NAME=value...; every variable already lives in the environment
 int builtin_export(String *args) {
-    setenv(strtok(args[1].chars, "="), strstr(args[1].chars, "=") + 1, true);
-    return HERMES_SUCCESS;
+    int result = HERMES_SUCCESS;
+    for (int i = 1; args[i].chars; i++) {
+        const char *eq = strchr(args[i].chars, '=');
+        if (!eq) continue;
+        if (eq == args[i].chars) {
+            fprintf(stderr, "export: %s: invalid variable name\n", args[i].chars);
+            result = HERMES_FAILURE;
+            continue;
+        }
+        char *var = strndup(args[i].chars, (size_t)(eq - args[i].chars));
+        if (!var || setenv(var, eq + 1, true) != 0) {
+            perror("export");
+            result = HERMES_FAILURE;
+        }
+        free(var);
+    }
+    return result;
 }
 
 int builtin_exit(String *args) {
@@ -41,6 +83,14 @@ int builtin_fish(String *args) {
     return HERMES_SUCCESS;
 }
 
+int builtin_true(String *args) {
+    return HERMES_SUCCESS;
+}
+
+int builtin_false(String *args) {
+    return HERMES_FAILURE;
+}
+
 int builtin_echo(String *args)  {
     int i = 1;
     while (args[i].chars != NULL) {
@@ -55,9 +105,15 @@ int builtin_cd(String *args) {
         fprintf(stderr, "sh: expected argument to \"cd\"\n\r");
         fflush(NULL);
     }
+    else if (strcmp(args[1].chars, "-j") == 0) {
+        return frecency_jump(&args[2]);
+    }
     else if (chdir(args[1].chars) != 0) {
         perror(name);
     }
+    else {
+        frecency_visit();
+    }
     return HERMES_SUCCESS;
 }
 
@@ -67,6 +123,10 @@ int builtin_help(String *args) {
     for (int i = 0; i < builtin_str_count; i++) {
         printf("\t%s\n", builtin_str[i]);
     }
+    puts("These run the command that follows them:");
+    for (int i = 0; i < prefix_str_count; i++) {
+        printf("\t%s\n", prefix_str[i]);
+    }
     return HERMES_SUCCESS;
 }
 
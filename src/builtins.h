@@ -1,13 +1,17 @@
 #ifndef HERMES_BUILTINS_H
 #define HERMES_BUILTINS_H
 
+#include <stdint.h>
 #include "globals.h"
 
+// args point into parsed trees and alias words that run again: read only
 typedef int (*builtin_function)(String *);
 
 extern char *builtin_str[];
 extern const int builtin_str_count;
 extern builtin_function builtin_func[];
+extern char *prefix_str[];
+extern const int prefix_str_count;
 
 int builtin_export(String *args);
 int builtin_exit(String *args);
@@ -17,13 +21,44 @@ int builtin_help(String *args);
 int builtin_clear(String *args);
 int builtin_fish(String *args);
 int builtin_history(String *args);
+int builtin_times(String *args);
+int builtin_laststat(String *args);
+int builtin_parallel(String *args);
+int builtin_z(String *args);
+int builtin_ulimit(String *args);
+int builtin_true(String *args);
+int builtin_false(String *args);
+int builtin_alias(String *args);
+int builtin_unalias(String *args);
 int append_to_history(const char *command);
 
 typedef struct HistoryEntry {
-    int id;
-    char *command;
+    uint32_t offset;    // into History.arena
+    uint32_t len;
 } HistoryEntry;
 
-int read_history(HistoryEntry **entries);
+// Commands stored back to back, NUL-terminated, in one append-only arena
+typedef struct History {
+    char *arena;
+    size_t arena_len, arena_cap;
+    HistoryEntry *entries;
+    int count, cap;
+} History;
+
+int read_history(History *history);
+const char *history_command(const History *history, int index);
+void free_history(History *history);
+
+// Session history, loaded lazily the first time it is looked at
+bool history_loaded(void);
+// Load it now, e.g. while the line editor waits for input
+void history_preload(void);
+int history_size(void);
+const char *history_at(int index);
+// Most recent command starting with prefix, or NULL until history is loaded
+const char *history_suggest(const char *prefix);
+int history_add(const char *command);
+// Pull commands other live sessions added to the shared ring, if enabled
+void history_sync(void);
 
 #endif
@@ -0,0 +1,446 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/file.h>
+#include <time.h>
+#include "cache.h"
+#include "path.h"
+#include "stats.h"
+
+/*
+ * One file per entry, named by the FNV-1a hash of its key:
+ *
+ *   header    CACHE_HEADER_LEN bytes: magic, created, status, key length
+ *   key       the full key, compared on lookup so collisions are misses
+ *   output    captured stdout
+ *
+ * The header has a fixed width so the child can write straight into the
+ * entry and the status is patched in afterwards. Entry mtimes track the
+ * last use, which is what eviction orders by.
+ */
+#define CACHE_MAGIC "hermes-cache 1"
+#define CACHE_HEADER_LEN 64
+#define CACHE_DEFAULT_MAX (64ull << 20)
+#define CACHE_COPY_CHUNK 65536
+
+int launch_with(String *args, int argc, const LaunchPolicy *policy);
+
+typedef struct CacheKey {
+    char *data;
+    size_t len, cap;
+    bool failed;
+} CacheKey;
+
+typedef struct CacheEntry {
+    char file[17];
+    off_t size;
+    struct timespec used;
+} CacheEntry;
+
+static unsigned long long cache_max = CACHE_DEFAULT_MAX;
+static unsigned long long session_hits = 0, session_misses = 0;
+static char *store = NULL;
+
+// $XDG_CACHE_HOME/hermes/cache/, falling back to ~/.cache
+static const char *store_dir(void) {
+    if (!store) {
+        store = path_xdg("XDG_CACHE_HOME", ".cache", "cache/");
+        if (store && path_mkdir_parents(store) == -1) {
+            free(store);
+            store = NULL;
+        }
+    }
+    return store;
+}
+
+bool cache_set_max(const char *size) {
+    char *end;
+    errno = 0;
+    unsigned long long n = strtoull(size, &end, 10);
+    if (end == size || errno || size[0] == '-') return false;
+
+    int shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+    }
+    if (*end || n == 0 || n > (ULLONG_MAX >> shift)) return false;
+    cache_max = n << shift;
+    return true;
+}
+
+static void key_append(CacheKey *key, const char *bytes, size_t len) {
+    if (key->failed) return;
+    if (key->len + len > key->cap) {
+        size_t cap = key->cap ? key->cap : 256;
+        while (cap < key->len + len) cap *= 2;
+        char *grown = realloc(key->data, cap);
+        if (!grown) {
+            key->failed = true;
+            return;
+        }
+        key->data = grown;
+        key->cap = cap;
+    }
+    memcpy(key->data + key->len, bytes, len);
+    key->len += len;
+}
+
+// "tag length:bytes\n", so no choice of separator can make two keys collide
+static void key_field(CacheKey *key, const char *tag, const char *value) {
+    char prefix[32];
+    size_t len = strlen(value);
+    int n = snprintf(prefix, sizeof(prefix), "%s %zu:", tag, len);
+    key_append(key, prefix, (size_t)n);
+    key_append(key, value, len);
+    key_append(key, "\n", 1);
+}
+
+static void key_dep(CacheKey *key, const char *path) {
+    struct stat st;
+    char stamp[96] = "missing";
+    if (stat(path, &st) == 0)
+        snprintf(stamp, sizeof(stamp), "%lld.%09ld %lld %llu", (long long)st.st_mtim.tv_sec,
+                 st.st_mtim.tv_nsec, (long long)st.st_size, (unsigned long long)st.st_ino);
+    key_field(key, "dep", path);
+    key_field(key, "mtime", stamp);
+}
+
+static void key_env(CacheKey *key, const char *var) {
+    const char *value = getenv(var);
+    key_field(key, "env", var);
+    if (value) key_field(key, "value", value);
+    else key_field(key, "unset", "");
+}
+
+static uint64_t key_hash(const CacheKey *key) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < key->len; i++) {
+        h ^= (unsigned char)key->data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static bool is_entry(const char *file) {
+    return strlen(file) == 16 && strspn(file, "0123456789abcdef") == 16;
+}
+
+static bool write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Copy fd from offset to EOF onto stdout
+static bool replay(int fd, off_t offset) {
+    static char chunk[CACHE_COPY_CHUNK];
+    fflush(stdout);
+    for (;;) {
+        ssize_t n = pread(fd, chunk, sizeof(chunk), offset);
+        if (n == -1 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) return true;
+        if (!write_all(STDOUT_FILENO, chunk, (size_t)n)) return false;
+        offset += n;
+    }
+}
+
+static bool write_header(int fd, long long created, int status, size_t key_len) {
+    char header[CACHE_HEADER_LEN + 1];
+    memset(header, ' ', CACHE_HEADER_LEN);
+    int n = snprintf(header, sizeof(header), "%s %lld %d %zu", CACHE_MAGIC, created, status, key_len);
+    if (n < 0 || n >= CACHE_HEADER_LEN) return false;
+    header[n] = ' ';
+    header[CACHE_HEADER_LEN - 1] = '\n';
+    return pwrite(fd, header, CACHE_HEADER_LEN, 0) == CACHE_HEADER_LEN;
+}
+
+// Replay a stored result for key; false on a miss, a stale entry or a collision
+static bool lookup(const char *path, const CacheKey *key, long ttl, int *status) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd == -1) return false;
+
+    char header[CACHE_HEADER_LEN + 1];
+    long long created;
+    size_t key_len;
+    bool hit = pread(fd, header, CACHE_HEADER_LEN, 0) == CACHE_HEADER_LEN;
+    header[CACHE_HEADER_LEN] = '\0';
+    hit = hit && sscanf(header, CACHE_MAGIC " %lld %d %zu", &created, status, &key_len) == 3;
+    hit = hit && key_len == key->len && (ttl == 0 || (long long)time(NULL) - created <= ttl);
+
+    char *stored = hit ? malloc(key_len) : NULL;
+    hit = stored && pread(fd, stored, key_len, CACHE_HEADER_LEN) == (ssize_t)key_len
+          && memcmp(stored, key->data, key_len) == 0;
+    free(stored);
+
+    if (hit) {
+        futimens(fd, NULL);     // mark as recently used
+        replay(fd, CACHE_HEADER_LEN + (off_t)key_len);
+    }
+    close(fd);
+    return hit;
+}
+
+// Run cmd with stdout going into a fresh entry, then show and publish it
+static int run_and_store(String *cmd, int cmd_argc, const LaunchPolicy *policy,
+                         const char *path, const CacheKey *key, bool *stored) {
+    char tmp[PATH_MAX];
+    *stored = false;
+    int n = snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+    int fd = n > 0 && n < (int)sizeof(tmp) ? open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600) : -1;
+    if (fd == -1) return launch_with(cmd, cmd_argc, policy);
+
+    long long created = (long long)time(NULL);
+    int saved = -1;
+    if (write_header(fd, created, 0, key->len)
+        && pwrite(fd, key->data, key->len, CACHE_HEADER_LEN) == (ssize_t)key->len
+        && lseek(fd, CACHE_HEADER_LEN + (off_t)key->len, SEEK_SET) != -1) {
+        fflush(stdout);
+        saved = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    }
+    if (saved == -1 || dup2(fd, STDOUT_FILENO) == -1) {
+        if (saved != -1) close(saved);
+        close(fd);
+        unlink(tmp);
+        return launch_with(cmd, cmd_argc, policy);
+    }
+
+    int status = launch_with(cmd, cmd_argc, policy);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    replay(fd, CACHE_HEADER_LEN + (off_t)key->len);
+
+    // Not found, not executable and killed by a signal are not results worth keeping
+    *stored = status >= 0 && status < 126 && write_header(fd, created, status, key->len)
+              && rename(tmp, path) == 0;
+    if (!*stored) unlink(tmp);
+    close(fd);
+    return status;
+}
+
+static CacheEntry *list_entries(const char *dir, int *count, unsigned long long *total) {
+    *count = 0;
+    *total = 0;
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+
+    int cap = 64;
+    CacheEntry *entries = malloc(cap * sizeof(CacheEntry));
+    struct dirent *de;
+    while (entries && (de = readdir(d))) {
+        struct stat st;
+        if (!is_entry(de->d_name) || fstatat(dirfd(d), de->d_name, &st, 0) == -1) continue;
+        if (*count == cap) {
+            cap *= 2;
+            CacheEntry *grown = realloc(entries, cap * sizeof(CacheEntry));
+            if (!grown) break;
+            entries = grown;
+        }
+        CacheEntry *e = &entries[(*count)++];
+        memcpy(e->file, de->d_name, sizeof(e->file));
+        e->size = st.st_size;
+        e->used = st.st_mtim;
+        *total += (unsigned long long)st.st_size;
+    }
+    closedir(d);
+    return entries;
+}
+
+static int compare_used(const void *a, const void *b) {
+    const struct timespec *x = &((const CacheEntry *)a)->used;
+    const struct timespec *y = &((const CacheEntry *)b)->used;
+    if (x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+// Drop least recently used entries until the store fits under cache_max
+static void evict(const char *dir) {
+    int count;
+    unsigned long long total;
+    CacheEntry *entries = list_entries(dir, &count, &total);
+    if (entries && total > cache_max) {
+        int dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        qsort(entries, count, sizeof(CacheEntry), compare_used);
+        for (int i = 0; i < count && total > cache_max && dfd != -1; i++) {
+            if (unlinkat(dfd, entries[i].file, 0) == 0)
+                total -= (unsigned long long)entries[i].size;
+        }
+        if (dfd != -1) close(dfd);
+    }
+    free(entries);
+}
+
+// Persistent "hits misses" totals, shared by every session
+static bool read_totals(int fd, unsigned long long totals[2]) {
+    char buf[64];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    return sscanf(buf, "%llu %llu", &totals[0], &totals[1]) == 2;
+}
+
+static void count_lookup(const char *dir, bool hit) {
+    if (hit) session_hits++;
+    else session_misses++;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%sstats", dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) return;
+    if (flock(fd, LOCK_EX) == 0) {
+        unsigned long long totals[2] = {0, 0};
+        read_totals(fd, totals);
+        totals[hit ? 0 : 1]++;
+        char buf[64];
+        int n = snprintf(buf, sizeof(buf), "%llu %llu\n", totals[0], totals[1]);
+        if (pwrite(fd, buf, (size_t)n, 0) == n) ftruncate(fd, n);
+    }
+    close(fd);
+}
+
+static void print_size(const char *label, unsigned long long bytes) {
+    if (bytes >= 1ull << 20) printf("%s%.1f MiB", label, (double)bytes / (1 << 20));
+    else printf("%s%.1f KiB", label, (double)bytes / (1 << 10));
+}
+
+static void print_counts(const char *label, unsigned long long hits, unsigned long long misses) {
+    unsigned long long lookups = hits + misses;
+    printf("%-9s %llu hits, %llu misses", label, hits, misses);
+    if (lookups) printf(" (%.1f%% hit rate)", 100.0 * (double)hits / (double)lookups);
+    printf("\n");
+}
+
+static int print_stats(const char *dir) {
+    int count;
+    unsigned long long total, totals[2] = {0, 0};
+    free(list_entries(dir, &count, &total));
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%sstats", dir);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd != -1) {
+        flock(fd, LOCK_SH);
+        read_totals(fd, totals);
+        close(fd);
+    }
+
+    printf("store     %s\n", dir);
+    printf("entries   %d, ", count);
+    print_size("", total);
+    print_size(" of ", cache_max);
+    printf("\n");
+    print_counts("session", session_hits, session_misses);
+    print_counts("total", totals[0], totals[1]);
+    fflush(stdout);
+    return 0;
+}
+
+// Remove every entry, leftover temporary file and the counters
+static int clear_store(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror("cache");
+        return 1;
+    }
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.') continue;
+        if (unlinkat(dirfd(d), de->d_name, 0) == -1 && errno != ENOENT)
+            fprintf(stderr, "cache: %s%s: %s\n", dir, de->d_name, strerror(errno));
+    }
+    closedir(d);
+    session_hits = session_misses = 0;
+    return 0;
+}
+
+static int usage_error(String *args, int argc, CacheKey *key, const char *problem) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (problem) fprintf(stderr, "cache: %s\n", problem);
+    fprintf(stderr, "cache: usage: cache [--ttl S] [--dep FILE...] [--env VAR...] -- cmd [args]\n"
+                    "       cache --stats | --clear\n");
+    stats_record(args, argc, 2, true, &start, NULL);
+    free(key->data);
+    return 2;
+}
+
+int cache_run(String *args, int argc, const LaunchPolicy *policy) {
+    CacheKey key = {0};
+    const char *dir = store_dir();
+    if (argc == 2 && (strcmp(args[1].chars, "--stats") == 0 || strcmp(args[1].chars, "--clear") == 0)) {
+        if (!dir) {
+            fprintf(stderr, "cache: no cache directory, set HOME or XDG_CACHE_HOME\n");
+            return 1;
+        }
+        return args[1].chars[2] == 's' ? print_stats(dir) : clear_store(dir);
+    }
+
+    long ttl = 0;
+    int i = 1;
+    for (; i < argc; i++) {
+        const char *arg = args[i].chars;
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+        if (strcmp(arg, "--ttl") == 0 && i + 1 < argc) {
+            char *end;
+            ttl = strtol(args[++i].chars, &end, 10);
+            if (*end || end == args[i].chars || ttl < 0)
+                return usage_error(args, argc, &key, "--ttl expects a number of seconds");
+            continue;
+        }
+        // --dep and --env take every word up to the next option, hence the --
+        if ((strcmp(arg, "--dep") == 0 || strcmp(arg, "--env") == 0)
+            && i + 1 < argc && args[i + 1].chars[0] != '-') {
+            bool dep = arg[2] == 'd';
+            while (i + 1 < argc && args[i + 1].chars[0] != '-') {
+                i++;
+                if (dep) key_dep(&key, args[i].chars);
+                else key_env(&key, args[i].chars);
+            }
+            continue;
+        }
+        if (arg[0] == '-') return usage_error(args, argc, &key, NULL);
+        break;
+    }
+    if (i >= argc) return usage_error(args, argc, &key, "no command");
+
+    String *cmd = args + i;
+    int cmd_argc = argc - i;
+    char cwd[PATH_MAX];
+    key_field(&key, "cwd", getcwd(cwd, sizeof(cwd)) ? cwd : "");
+    for (int j = 0; j < cmd_argc; j++) key_field(&key, "arg", cmd[j].chars);
+
+    char path[PATH_MAX];
+    if (!dir || key.failed || snprintf(path, sizeof(path), "%s%016llx", dir,
+                                       (unsigned long long)key_hash(&key)) >= (int)sizeof(path)) {
+        free(key.data);
+        return launch_with(cmd, cmd_argc, policy);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status;
+    if (lookup(path, &key, ttl, &status)) {
+        count_lookup(dir, true);
+        stats_record(args, argc, status, true, &start, NULL);
+        free(key.data);
+        return status;
+    }
+
+    count_lookup(dir, false);
+    bool stored;
+    status = run_and_store(cmd, cmd_argc, policy, path, &key, &stored);
+    if (stored) evict(dir);
+    free(key.data);
+    return status;
+}
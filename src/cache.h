@@ -0,0 +1,21 @@
+#ifndef HERMES_CACHE_H
+#define HERMES_CACHE_H
+
+#include "globals.h"
+#include "policy.h"
+
+/*
+ * cache [--ttl S] [--dep FILE...] [--env VAR...] [--] cmd args
+ * cache --stats | --clear
+ *
+ * Memoizes stdout and the exit status of deterministic commands in a
+ * content-addressed store under $XDG_CACHE_HOME/hermes/cache, keyed by argv,
+ * cwd, the selected environment variables and the dependencies' mtimes.
+ * A hit replays the stored output without forking. Returns the exit status.
+ */
+int cache_run(String *args, int argc, const LaunchPolicy *policy);
+
+// Size cap for the store, e.g. "64M"; least recently used entries go first
+bool cache_set_max(const char *size);
+
+#endif
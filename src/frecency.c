@@ -0,0 +1,329 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "builtins.h"
+#include "frecency.h"
+#include "path.h"
+
+#define FRECENCY_MAGIC 0x5a524448u     // "HDRZ"
+#define FRECENCY_VERSION 1
+#define FRECENCY_MAX_DIRS 32768
+#define FRECENCY_PATH_MAX 246
+#define FRECENCY_AGE_LIMIT 100000.0f   // total rank that triggers aging
+#define FRECENCY_MIN_RANK 0.1f         // aged below this, a directory is forgotten
+#define FRECENCY_INDEX_SIZE (FRECENCY_MAX_DIRS * 2)
+#define FRECENCY_JUMP_TRIES 8
+#define FRECENCY_LIST_MAX 20
+
+typedef struct FrecencyRecord {
+    float rank;
+    uint32_t last;                  // time of the last visit
+    uint16_t len;
+    char path[FRECENCY_PATH_MAX];
+} FrecencyRecord;
+
+typedef struct FrecencyDb {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t generation;            // bumped whenever records move
+    float total;
+    uint32_t reserved[3];
+    uint64_t masks[FRECENCY_MAX_DIRS];      // byte_mask() of each path, scanned densely by jumps
+    FrecencyRecord records[FRECENCY_MAX_DIRS];
+} FrecencyDb;
+
+static FrecencyDb *db = NULL;
+static int db_fd = -1;
+static bool db_failed = false;
+
+// Exact-path lookup table over db->records: slot holds record index + 1
+static uint32_t index_table[FRECENCY_INDEX_SIZE];
+static uint32_t index_generation = 0;
+static bool index_valid = false;
+
+static FrecencyDb *db_open(void) {
+    if (db || db_failed) return db;
+    db_failed = true;
+
+    char *path = path_xdg("XDG_DATA_HOME", ".local/share", "dirs");
+    if (!path) return NULL;
+    path_mkdir_parents(path);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    free(path);
+    if (fd < 0) return NULL;
+
+    // Zero-filled is an empty database, so growing the file initialises it
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || (sb.st_size < (off_t)sizeof(FrecencyDb) && ftruncate(fd, sizeof(FrecencyDb)) == -1)) {
+        close(fd);
+        return NULL;
+    }
+
+    FrecencyDb *d = mmap(NULL, sizeof(FrecencyDb), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (d == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    flock(fd, LOCK_EX);
+    if (d->magic == 0) {
+        d->version = FRECENCY_VERSION;
+        d->magic = FRECENCY_MAGIC;
+    }
+    flock(fd, LOCK_UN);
+    if (d->magic != FRECENCY_MAGIC || d->version != FRECENCY_VERSION || d->count > FRECENCY_MAX_DIRS) {
+        munmap(d, sizeof(FrecencyDb));
+        close(fd);
+        return NULL;
+    }
+
+    db_failed = false;
+    db_fd = fd;
+    db = d;
+    return db;
+}
+
+static uint32_t hash_path(const char *path, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)path[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void index_insert(uint32_t record) {
+    const FrecencyRecord *r = &db->records[record];
+    uint32_t slot = hash_path(r->path, r->len) & (FRECENCY_INDEX_SIZE - 1);
+    while (index_table[slot])
+        slot = (slot + 1) & (FRECENCY_INDEX_SIZE - 1);
+    index_table[slot] = record + 1;
+}
+
+static void index_rebuild(void) {
+    memset(index_table, 0, sizeof(index_table));
+    for (uint32_t i = 0; i < db->count; i++)
+        index_insert(i);
+    index_generation = db->generation;
+    index_valid = true;
+}
+
+static int find(const char *path, size_t len) {
+    if (!index_valid || index_generation != db->generation)
+        index_rebuild();
+
+    uint32_t slot = hash_path(path, len) & (FRECENCY_INDEX_SIZE - 1);
+    while (index_table[slot]) {
+        uint32_t i = index_table[slot] - 1;
+        const FrecencyRecord *r = &db->records[i];
+        if (i < db->count && r->len == len && memcmp(r->path, path, len) == 0)
+            return (int)i;
+        slot = (slot + 1) & (FRECENCY_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+// Letters (case folded) and digits get a bit each, other bytes share the
+// rest: a fragment can only be in a path whose mask covers its own
+static uint64_t byte_mask(const char *s, size_t len) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i] | 0x20;
+        unsigned bit;
+        if (c >= 'a' && c <= 'z') bit = c - 'a';
+        else if (c >= '0' && c <= '9') bit = 26 + (c - '0');
+        else bit = 36 + (unsigned char)s[i] % 28;
+        mask |= UINT64_C(1) << bit;
+    }
+    return mask;
+}
+
+static double score(const FrecencyRecord *r, uint32_t now) {
+    uint32_t age = now > r->last ? now - r->last : 0;
+    double rank = r->rank;
+    if (age < 3600) return rank * 4;
+    if (age < 86400) return rank * 2;
+    if (age < 604800) return rank / 2;
+    return rank / 4;
+}
+
+// Decay every rank and forget directories nobody has visited in a long while
+static void age(void) {
+    uint32_t kept = 0;
+    float total = 0;
+    for (uint32_t i = 0; i < db->count; i++) {
+        FrecencyRecord *r = &db->records[i];
+        r->rank *= 0.9f;
+        if (r->rank < FRECENCY_MIN_RANK) continue;
+        if (kept != i) {
+            db->records[kept] = *r;
+            db->masks[kept] = db->masks[i];
+        }
+        total += r->rank;
+        kept++;
+    }
+    db->count = kept;
+    db->total = total;
+    db->generation++;
+}
+
+static void forget(int i) {
+    db->total -= db->records[i].rank;
+    db->records[i] = db->records[db->count - 1];
+    db->masks[i] = db->masks[db->count - 1];
+    db->count--;
+    db->generation++;
+}
+
+void frecency_visit(void) {
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd)) || !db_open()) return;
+    size_t len = strlen(cwd);
+    if (len >= FRECENCY_PATH_MAX) return;
+
+    uint32_t now = (uint32_t)time(NULL);
+    flock(db_fd, LOCK_EX);
+
+    int i = find(cwd, len);
+    if (i >= 0) {
+        db->records[i].rank += 1.0f;
+        db->records[i].last = now;
+    } else {
+        bool appended = db->count < FRECENCY_MAX_DIRS;
+        if (appended) {
+            i = (int)db->count++;
+        } else {
+            // Full: the least valuable directory makes room
+            i = 0;
+            for (uint32_t j = 1; j < db->count; j++)
+                if (score(&db->records[j], now) < score(&db->records[i], now)) i = (int)j;
+            db->total -= db->records[i].rank;
+        }
+        FrecencyRecord *r = &db->records[i];
+        r->rank = 1.0f;
+        r->last = now;
+        r->len = (uint16_t)len;
+        db->masks[i] = byte_mask(cwd, len);
+        memcpy(r->path, cwd, len + 1);
+
+        bool current = index_valid && index_generation == db->generation;
+        db->generation++;
+        if (appended && current) {
+            index_insert((uint32_t)i);
+            index_generation = db->generation;
+        }
+    }
+
+    db->total += 1.0f;
+    if (db->total > FRECENCY_AGE_LIMIT)
+        age();
+
+    flock(db_fd, LOCK_UN);
+}
+
+double frecency_score(const char *path) {
+    if (!db_open()) return 0;
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') len--;
+
+    int i = find(path, len);
+    return i < 0 ? 0 : score(&db->records[i], (uint32_t)time(NULL));
+}
+
+// Fragments must all appear in the path, in order
+static bool matches(const FrecencyRecord *r, String *fragments) {
+    const char *p = r->path;
+    for (int f = 0; fragments[f].chars; f++) {
+        p = strstr(p, fragments[f].chars);
+        if (!p) return false;
+        p += strlen(fragments[f].chars);
+    }
+    return true;
+}
+
+int frecency_jump(String *fragments) {
+    if (!fragments[0].chars) {
+        fprintf(stderr, "z: expected a directory fragment\n");
+        return HERMES_FAILURE;
+    }
+    if (!db_open()) return HERMES_FAILURE;
+
+    uint64_t mask = 0;
+    for (int f = 0; fragments[f].chars; f++)
+        mask |= byte_mask(fragments[f].chars, strlen(fragments[f].chars));
+
+    uint32_t now = (uint32_t)time(NULL);
+    char tried[FRECENCY_JUMP_TRIES][FRECENCY_PATH_MAX];
+
+    for (int attempt = 0; attempt < FRECENCY_JUMP_TRIES; attempt++) {
+        int best = -1;
+        double best_score = 0;
+        for (uint32_t i = 0; i < db->count; i++) {
+            if ((db->masks[i] & mask) != mask) continue;
+            const FrecencyRecord *r = &db->records[i];
+            if (!matches(r, fragments)) continue;
+            double s = score(r, now);
+            if (best >= 0 && s <= best_score) continue;
+
+            bool seen = false;
+            for (int t = 0; t < attempt && !seen; t++)
+                seen = strcmp(tried[t], r->path) == 0;
+            if (seen) continue;
+
+            best = (int)i;
+            best_score = s;
+        }
+        if (best < 0) break;
+
+        strcpy(tried[attempt], db->records[best].path);
+        if (chdir(tried[attempt]) == 0) {
+            frecency_visit();
+            return HERMES_SUCCESS;
+        }
+
+        // The directory is gone; drop it so it stops winning
+        if (errno == ENOENT || errno == ENOTDIR) {
+            flock(db_fd, LOCK_EX);
+            int i = find(tried[attempt], strlen(tried[attempt]));
+            if (i >= 0) forget(i);
+            flock(db_fd, LOCK_UN);
+        }
+    }
+
+    fprintf(stderr, "z: no match for");
+    for (int f = 0; fragments[f].chars; f++) fprintf(stderr, " %s", fragments[f].chars);
+    fprintf(stderr, "\n");
+    return HERMES_FAILURE;
+}
+
+static int compare_scores(const void *a, const void *b) {
+    double x = ((const double *)a)[0], y = ((const double *)b)[0];
+    return (x < y) - (x > y);
+}
+
+// z with no arguments lists the best directories, z frag... jumps
+int builtin_z(String *args) {
+    if (args[1].chars)
+        return frecency_jump(&args[1]);
+    if (!db_open()) return HERMES_FAILURE;
+
+    uint32_t now = (uint32_t)time(NULL);
+    double (*ranked)[2] = malloc((db->count + 1) * sizeof(*ranked));
+    if (!ranked) return HERMES_FAILURE;
+    for (uint32_t i = 0; i < db->count; i++) {
+        ranked[i][0] = score(&db->records[i], now);
+        ranked[i][1] = i;
+    }
+    qsort(ranked, db->count, sizeof(*ranked), compare_scores);
+
+    uint32_t shown = db->count < FRECENCY_LIST_MAX ? db->count : FRECENCY_LIST_MAX;
+    for (uint32_t i = shown; i-- > 0;)
+        printf("%10.1f  %s\n", ranked[i][0], db->records[(uint32_t)ranked[i][1]].path);
+    fflush(stdout);
+    free(ranked);
+    return HERMES_SUCCESS;
+}
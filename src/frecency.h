@@ -0,0 +1,21 @@
+#ifndef HERMES_FRECENCY_H
+#define HERMES_FRECENCY_H
+
+#include "globals.h"
+
+/*
+ * Directory visit database for z-style jumping. Records live in a fixed
+ * size file under $XDG_DATA_HOME/hermes that is mmap'd and shared by all
+ * sessions; ranks age so the database stays bounded and current.
+ */
+
+// Record a visit to the current working directory
+void frecency_visit(void);
+
+// Rank of an absolute directory path, 0 if it was never visited
+double frecency_score(const char *path);
+
+// chdir to the best directory containing every fragment in order
+int frecency_jump(String *fragments);
+
+#endif
@@ -0,0 +1,564 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include "glob.h"
+
+#define GLOB_DENTS_SIZE (64 * 1024)
+#define GLOB_MAX_THREADS 8
+
+typedef enum glob_op {
+    GLOB_LITERAL,
+    GLOB_ANY,
+    GLOB_STAR,
+    GLOB_CLASS,
+} glob_op_t;
+
+typedef struct GlobOp {
+    glob_op_t op;
+    unsigned char c;
+    uint64_t set[4];    // GLOB_CLASS: one bit per byte value
+} GlobOp;
+
+typedef struct GlobSegment {
+    GlobOp *ops;
+    int op_count;
+    char *literal;      // set when the segment has no magic at all
+    bool recursive;     // "**"
+    bool dot;           // starts with a literal '.', so may match hidden names
+} GlobSegment;
+
+struct GlobPattern {
+    GlobSegment *segs;
+    int seg_count;
+    bool absolute;
+    bool dir_only;      // pattern ended in '/'
+    bool recursive;     // contains a "**" segment
+};
+
+// Raw directory record as returned by getdents64
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct GlobWork {
+    struct GlobWork *next;
+    int seg;
+    char path[];
+} GlobWork;
+
+typedef struct GlobWalk {
+    const GlobPattern *pat;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    GlobWork *queue;
+    int pending;        // queued + in-flight work items
+} GlobWalk;
+
+typedef struct GlobWorker {
+    GlobWalk *walk;
+    char *dents;
+    char **paths;
+    size_t count, cap;
+    GlobWork *batch;
+    int batch_count;
+} GlobWorker;
+
+typedef struct GlobHeld {
+    struct GlobHeld *next;
+    char **paths;
+    int count;
+} GlobHeld;
+
+static GlobHeld *held = NULL;
+
+bool glob_has_magic(const char *word) {
+    for (const char *p = word; *p; p++) {
+        if (*p == '\\') {
+            if (p[1]) p++;
+            continue;
+        }
+        if (*p == '*' || *p == '?') return true;
+        if (*p == '[' && strchr(p + 1, ']')) return true;
+    }
+    return false;
+}
+
+static void set_bit(uint64_t *set, unsigned char c) {
+    set[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+static bool test_bit(const uint64_t *set, unsigned char c) {
+    return (set[c >> 6] >> (c & 63)) & 1;
+}
+
+// Parse "[...]" starting just after the '['; returns the position after ']' or NULL
+static const char *compile_class(const char *p, const char *end, GlobOp *op) {
+    bool negate = false;
+    memset(op->set, 0, sizeof(op->set));
+    op->op = GLOB_CLASS;
+
+    if (p < end && (*p == '!' || *p == '^')) {
+        negate = true;
+        p++;
+    }
+
+    bool first = true;
+    while (p < end && (*p != ']' || first)) {
+        first = false;
+        unsigned char lo = (unsigned char)*p++;
+        if (lo == '\\' && p < end) lo = (unsigned char)*p++;
+
+        if (p + 1 < end && *p == '-' && p[1] != ']') {
+            unsigned char hi = (unsigned char)p[1];
+            p += 2;
+            if (hi == '\\' && p < end) hi = (unsigned char)*p++;
+            for (unsigned c = lo; c <= hi; c++) set_bit(op->set, (unsigned char)c);
+        } else {
+            set_bit(op->set, lo);
+        }
+    }
+    if (p >= end) return NULL;
+
+    if (negate)
+        for (int i = 0; i < 4; i++) op->set[i] = ~op->set[i];
+    // '/' never matches inside a component
+    op->set['/' >> 6] &= ~((uint64_t)1 << ('/' & 63));
+    return p + 1;
+}
+
+static bool compile_segment(const char *p, const char *end, GlobSegment *seg) {
+    memset(seg, 0, sizeof(*seg));
+    size_t len = (size_t)(end - p);
+
+    if (len == 2 && p[0] == '*' && p[1] == '*') {
+        seg->recursive = true;
+        return true;
+    }
+
+    seg->ops = malloc((len + 1) * sizeof(GlobOp));
+    if (!seg->ops) return false;
+
+    bool magic = false;
+    while (p < end) {
+        GlobOp *op = &seg->ops[seg->op_count];
+        switch (*p) {
+        case '*':
+            while (p < end && *p == '*') p++;
+            op->op = GLOB_STAR;
+            magic = true;
+            break;
+        case '?':
+            op->op = GLOB_ANY;
+            p++;
+            magic = true;
+            break;
+        case '[': {
+            const char *next = compile_class(p + 1, end, op);
+            if (next) {
+                p = next;
+                magic = true;
+                break;
+            }
+            op->op = GLOB_LITERAL;
+            op->c = '[';
+            p++;
+            break;
+        }
+        case '\\':
+            if (p + 1 < end) p++;
+            /* fall through */
+        default:
+            op->op = GLOB_LITERAL;
+            op->c = (unsigned char)*p++;
+            break;
+        }
+        seg->op_count++;
+    }
+
+    seg->dot = seg->op_count > 0 && seg->ops[0].op == GLOB_LITERAL && seg->ops[0].c == '.';
+
+    if (!magic) {
+        seg->literal = malloc((size_t)seg->op_count + 1);
+        if (!seg->literal) return false;
+        for (int i = 0; i < seg->op_count; i++) seg->literal[i] = (char)seg->ops[i].c;
+        seg->literal[seg->op_count] = '\0';
+    }
+    return true;
+}
+
+GlobPattern *glob_compile(const char *pattern) {
+    GlobPattern *pat = calloc(1, sizeof(*pat));
+    if (!pat) return NULL;
+
+    size_t len = strlen(pattern);
+    pat->absolute = pattern[0] == '/';
+    pat->dir_only = len > 0 && pattern[len - 1] == '/';
+    pat->segs = calloc(len / 2 + 2, sizeof(GlobSegment));
+    if (!pat->segs) {
+        free(pat);
+        return NULL;
+    }
+
+    const char *p = pattern;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char *end = p;
+        while (*end && *end != '/') end++;
+
+        GlobSegment *seg = &pat->segs[pat->seg_count];
+        if (!compile_segment(p, end, seg)) {
+            glob_pattern_free(pat);
+            return NULL;
+        }
+        pat->seg_count++;
+        // "**/**" walks the same tree twice; collapse it
+        if (seg->recursive && pat->seg_count > 1 && pat->segs[pat->seg_count - 2].recursive)
+            pat->seg_count--;
+        if (seg->recursive) pat->recursive = true;
+        p = end;
+    }
+
+    if (pat->seg_count == 0) {
+        glob_pattern_free(pat);
+        return NULL;
+    }
+    return pat;
+}
+
+void glob_pattern_free(GlobPattern *pat) {
+    if (!pat) return;
+    for (int i = 0; i < pat->seg_count + 1 && pat->segs; i++) {
+        free(pat->segs[i].ops);
+        free(pat->segs[i].literal);
+    }
+    free(pat->segs);
+    free(pat);
+}
+
+static bool op_matches(const GlobOp *op, unsigned char c) {
+    switch (op->op) {
+    case GLOB_LITERAL: return op->c == c;
+    case GLOB_ANY:     return true;
+    case GLOB_CLASS:   return test_bit(op->set, c);
+    default:           return false;
+    }
+}
+
+// Linear-time wildcard match: only the most recent '*' ever needs revisiting
+static bool segment_match(const GlobSegment *seg, const char *name) {
+    int pi = 0, star = -1;
+    const char *s = name, *star_s = NULL;
+
+    while (*s) {
+        if (pi < seg->op_count) {
+            const GlobOp *op = &seg->ops[pi];
+            if (op->op == GLOB_STAR) {
+                star = pi++;
+                star_s = s;
+                continue;
+            }
+            if (op_matches(op, (unsigned char)*s)) {
+                pi++;
+                s++;
+                continue;
+            }
+        }
+        if (star < 0) return false;
+        pi = star + 1;
+        s = ++star_s;
+    }
+    while (pi < seg->op_count && seg->ops[pi].op == GLOB_STAR) pi++;
+    return pi == seg->op_count;
+}
+
+bool glob_match_name(const GlobPattern *pat, int segment, const char *name) {
+    if (segment < 0 || segment >= pat->seg_count) return false;
+    const GlobSegment *seg = &pat->segs[segment];
+    if (seg->recursive) return name[0] != '.';
+    if (seg->literal) return strcmp(seg->literal, name) == 0;
+    if (name[0] == '.' && !seg->dot) return false;
+    return segment_match(seg, name);
+}
+
+static size_t join_path(char *dst, const char *dir, const char *name) {
+    size_t dlen = strlen(dir), nlen = strlen(name);
+    bool sep = dlen > 0 && dir[dlen - 1] != '/';
+    size_t len = dlen + (sep ? 1 : 0) + nlen;
+    if (len >= PATH_MAX) return 0;
+
+    memcpy(dst, dir, dlen);
+    if (sep) dst[dlen] = '/';
+    memcpy(dst + len - nlen, name, nlen + 1);
+    return len;
+}
+
+static void emit(GlobWorker *w, const char *path, size_t len) {
+    if (w->count == w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 64;
+        char **paths = realloc(w->paths, cap * sizeof(char *));
+        if (!paths) return;
+        w->paths = paths;
+        w->cap = cap;
+    }
+    bool slash = w->walk->pat->dir_only;
+    char *copy = malloc(len + (slash ? 2 : 1));
+    if (!copy) return;
+    memcpy(copy, path, len);
+    if (slash) copy[len++] = '/';
+    copy[len] = '\0';
+    w->paths[w->count++] = copy;
+}
+
+static void push(GlobWorker *w, const char *path, size_t len, int seg) {
+    GlobWork *work = malloc(sizeof(GlobWork) + len + 1);
+    if (!work) return;
+    work->seg = seg;
+    memcpy(work->path, path, len + 1);
+    work->next = w->batch;
+    w->batch = work;
+    w->batch_count++;
+}
+
+// Publish this worker's new items and retire the one it just finished
+static void flush(GlobWorker *w) {
+    GlobWalk *walk = w->walk;
+    pthread_mutex_lock(&walk->lock);
+    while (w->batch) {
+        GlobWork *next = w->batch->next;
+        w->batch->next = walk->queue;
+        walk->queue = w->batch;
+        w->batch = next;
+    }
+    walk->pending += w->batch_count - 1;
+    if (w->batch_count > 0 || walk->pending == 0)
+        pthread_cond_broadcast(&walk->cond);
+    w->batch_count = 0;
+    pthread_mutex_unlock(&walk->lock);
+}
+
+static bool is_dir(int dirfd, const char *name, unsigned char type, bool follow) {
+    if (type == DT_DIR) return true;
+    if (type != DT_UNKNOWN && !(follow && type == DT_LNK)) return false;
+    struct stat sb;
+    if (fstatat(dirfd, name, &sb, follow ? 0 : AT_SYMLINK_NOFOLLOW) == -1) return false;
+    return S_ISDIR(sb.st_mode);
+}
+
+// An entry of dir (open as dirfd) tested against a non-recursive segment
+static void visit_entry(GlobWorker *w, const char *dir, int dirfd, int seg, const char *name, unsigned char type) {
+    const GlobPattern *pat = w->walk->pat;
+    if (!glob_match_name(pat, seg, name)) return;
+
+    bool last = seg == pat->seg_count - 1;
+    if (last && !pat->dir_only) {
+        char child[PATH_MAX];
+        size_t len = join_path(child, dir, name);
+        if (len) emit(w, child, len);
+        return;
+    }
+    if (!is_dir(dirfd, name, type, true)) return;
+
+    char child[PATH_MAX];
+    size_t len = join_path(child, dir, name);
+    if (!len) return;
+    if (last) emit(w, child, len);
+    else push(w, child, len, seg + 1);
+}
+
+static void visit(GlobWorker *w, const char *dir, int seg) {
+    const GlobPattern *pat = w->walk->pat;
+    const GlobSegment *s = &pat->segs[seg];
+    bool last = seg == pat->seg_count - 1;
+
+    // Plain names need no directory read, just a lookup further down
+    if (s->literal) {
+        char child[PATH_MAX];
+        size_t len = join_path(child, dir, s->literal);
+        if (!len) return;
+        if (!last) {
+            visit(w, child, seg + 1);
+            return;
+        }
+        struct stat sb;
+        if (stat(child, &sb) == -1) return;
+        if (pat->dir_only && !S_ISDIR(sb.st_mode)) return;
+        emit(w, child, len);
+        return;
+    }
+
+    // "**" followed by "**" or a literal can't share this directory's scan
+    bool inline_next = s->recursive && !last && !pat->segs[seg + 1].recursive && !pat->segs[seg + 1].literal;
+    if (s->recursive && !last && !inline_next)
+        visit(w, dir, seg + 1);
+
+    int fd = openat(AT_FDCWD, dir[0] ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, w->dents, GLOB_DENTS_SIZE);
+        if (n <= 0) break;
+
+        for (long off = 0; off < n;) {
+            struct linux_dirent64 *de = (struct linux_dirent64 *)(void *)(w->dents + off);
+            off += de->d_reclen;
+
+            const char *name = de->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            if (!s->recursive) {
+                visit_entry(w, dir, fd, seg, name, de->d_type);
+                continue;
+            }
+
+            // "**" matches zero or more directories, never hidden ones
+            if (inline_next) visit_entry(w, dir, fd, seg + 1, name, de->d_type);
+            if (name[0] == '.') continue;
+
+            bool dir_entry = is_dir(fd, name, de->d_type, false);
+            if (!last && !dir_entry) continue;
+
+            char child[PATH_MAX];
+            size_t len = join_path(child, dir, name);
+            if (!len) continue;
+            if (last && (dir_entry || !pat->dir_only)) emit(w, child, len);
+            if (dir_entry) push(w, child, len, seg);
+        }
+    }
+    close(fd);
+}
+
+static void *worker_run(void *arg) {
+    GlobWorker *w = arg;
+    GlobWalk *walk = w->walk;
+
+    for (;;) {
+        pthread_mutex_lock(&walk->lock);
+        while (!walk->queue && walk->pending > 0)
+            pthread_cond_wait(&walk->cond, &walk->lock);
+        GlobWork *work = walk->queue;
+        if (work) walk->queue = work->next;
+        pthread_mutex_unlock(&walk->lock);
+        if (!work) break;
+
+        visit(w, work->path, work->seg);
+        free(work);
+        flush(w);
+    }
+    return NULL;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int glob_expand(const GlobPattern *pat, char ***out) {
+    *out = NULL;
+    if (!pat) return 0;
+
+    GlobWalk walk = {.pat = pat, .queue = NULL, .pending = 1};
+    pthread_mutex_init(&walk.lock, NULL);
+    pthread_cond_init(&walk.cond, NULL);
+
+    // Only recursive patterns touch enough directories to be worth threads
+    int nworkers = 1;
+    if (pat->recursive) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nworkers = ncpu > GLOB_MAX_THREADS ? GLOB_MAX_THREADS : (ncpu < 1 ? 1 : (int)ncpu);
+    }
+
+    GlobWorker *workers = calloc((size_t)nworkers, sizeof(GlobWorker));
+    pthread_t *threads = calloc((size_t)nworkers, sizeof(pthread_t));
+    if (!workers || !threads) {
+        free(workers);
+        free(threads);
+        return 0;
+    }
+
+    const char *root = pat->absolute ? "/" : "";
+    walk.queue = malloc(sizeof(GlobWork) + strlen(root) + 1);
+    if (!walk.queue) {
+        free(workers);
+        free(threads);
+        return 0;
+    }
+    walk.queue->next = NULL;
+    walk.queue->seg = 0;
+    strcpy(walk.queue->path, root);
+
+    int started = 0;
+    for (int i = 0; i < nworkers; i++) {
+        workers[i].walk = &walk;
+        workers[i].dents = malloc(GLOB_DENTS_SIZE);
+        if (!workers[i].dents) break;
+        started++;
+    }
+    int spawned = 1;
+    for (int i = 1; i < started; i++) {
+        if (pthread_create(&threads[i], NULL, worker_run, &workers[i]) != 0) break;
+        spawned++;
+    }
+    if (started > 0) worker_run(&workers[0]);
+    for (int i = 1; i < spawned; i++) pthread_join(threads[i], NULL);
+
+    size_t total = 0;
+    for (int i = 0; i < nworkers; i++) total += workers[i].count;
+
+    char **paths = total ? malloc(total * sizeof(char *)) : NULL;
+    size_t n = 0;
+    for (int i = 0; i < nworkers; i++) {
+        for (size_t j = 0; j < workers[i].count; j++) {
+            if (paths) paths[n++] = workers[i].paths[j];
+            else free(workers[i].paths[j]);
+        }
+        free(workers[i].paths);
+        free(workers[i].dents);
+    }
+    free(workers);
+    free(threads);
+    pthread_mutex_destroy(&walk.lock);
+    pthread_cond_destroy(&walk.cond);
+
+    if (n == 0) {
+        free(paths);
+        return 0;
+    }
+
+    qsort(paths, n, sizeof(char *), compare_paths);
+    size_t uniq = 1;
+    for (size_t i = 1; i < n; i++) {
+        if (strcmp(paths[i], paths[uniq - 1]) == 0) free(paths[i]);
+        else paths[uniq++] = paths[i];
+    }
+
+    GlobHeld *h = malloc(sizeof(*h));
+    if (!h) {
+        for (size_t i = 0; i < uniq; i++) free(paths[i]);
+        free(paths);
+        return 0;
+    }
+    h->paths = paths;
+    h->count = (int)uniq;
+    h->next = held;
+    held = h;
+
+    *out = paths;
+    return (int)uniq;
+}
+
+void glob_reset(void) {
+    while (held) {
+        GlobHeld *next = held->next;
+        for (int i = 0; i < held->count; i++) free(held->paths[i]);
+        free(held->paths);
+        free(held);
+        held = next;
+    }
+}
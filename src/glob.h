@@ -0,0 +1,29 @@
+#ifndef HERMES_GLOB_H
+#define HERMES_GLOB_H
+
+#include "globals.h"
+
+typedef struct GlobPattern GlobPattern;
+
+// True if the word contains an unescaped *, ? or [
+bool glob_has_magic(const char *word);
+
+// Compile a pattern like "src/**/*.c" into a matcher, NULL on failure
+GlobPattern *glob_compile(const char *pattern);
+void glob_pattern_free(GlobPattern *pat);
+
+// Match a single path component against one compiled segment (no '/')
+bool glob_match_name(const GlobPattern *pat, int segment, const char *name);
+
+/*
+ * Walk the filesystem for every path matching pat. On success *out points
+ * to a sorted, de-duplicated array of paths and the count is returned; 0
+ * means nothing matched. The returned strings are owned by the glob module
+ * and stay valid until the next glob_reset().
+ */
+int glob_expand(const GlobPattern *pat, char ***out);
+
+// Release all storage handed out by glob_expand()
+void glob_reset(void);
+
+#endif
@@ -17,7 +17,6 @@
 #define PARSE_TOKEN_DELIM " \t"
 #define HERMES_SUCCESS 1
 #define HERMES_FAILURE 0
-#define CONFIG_FILE "/home/gingrspacecadet/hermes.conf"
 
 extern const char *name;
 
@@ -27,6 +26,7 @@ typedef const enum sizes {
 } sizes_t;
 
 typedef enum chars {
+    CTRL_C = 3,
     CTRL_D = 4,
     TAB = 9,
     ENTER = 13,
@@ -1,10 +1,12 @@
+#define _GNU_SOURCE     // memmem
 #include "builtins.h"
+#include "shared_history.h"
+#include "suggest.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_HISTORY_LINES 1000
-#define MAX_LINE 1024
+#define HISTORY_ARENA_MAX ((size_t)UINT32_MAX)
 
 // Safe function to get history file path
 static inline char *history_file(void) {
@@ -24,21 +26,53 @@ static int own_isspace(int c) { return (c == ' ' || (c >= '\t' && c <= '\r')); }
 // isdigit implementation
 static int own_isdigit(int c) { return (c >= '0' && c <= '9'); }
 
-// Trim whitespace
-static char *trim_whitespace(char *str) {
-    while (own_isspace((unsigned char)*str)) 
-        str++;
-    if (*str == '\0') 
-        return str;
-    char *end = str + strlen(str) - 1;
-    while (end > str && own_isspace((unsigned char)*end)) 
-        end--;
-    end[1] = '\0';
-    return str;
+const char *history_command(const History *history, int index) {
+    return history->arena + history->entries[index].offset;
+}
+
+// Append a command to the arena, growing it and the entry table by doubling
+static int history_push(History *history, const char *command, size_t len) {
+    if (history->arena_len + len + 1 > HISTORY_ARENA_MAX)
+        return HERMES_FAILURE;
+    if (history->arena_len + len + 1 > history->arena_cap) {
+        size_t cap = history->arena_cap ? history->arena_cap : 4096;
+        while (cap < history->arena_len + len + 1)
+            cap *= 2;
+        char *grown = realloc(history->arena, cap);
+        if (!grown)
+            return HERMES_FAILURE;
+        history->arena = grown;
+        history->arena_cap = cap;
+    }
+    if (history->count == history->cap) {
+        int cap = history->cap ? history->cap * 2 : 64;
+        HistoryEntry *grown = realloc(history->entries, cap * sizeof(HistoryEntry));
+        if (!grown)
+            return HERMES_FAILURE;
+        history->entries = grown;
+        history->cap = cap;
+    }
+
+    memcpy(history->arena + history->arena_len, command, len);
+    history->arena[history->arena_len + len] = '\0';
+    history->entries[history->count].offset = (uint32_t)history->arena_len;
+    history->entries[history->count].len = (uint32_t)len;
+    history->arena_len += len + 1;
+    history->count++;
+    return HERMES_SUCCESS;
 }
 
-// Read history
-int read_history(HistoryEntry **entries) {
+// Free history
+void free_history(History *history) {
+    free(history->arena);
+    free(history->entries);
+    memset(history, 0, sizeof(*history));
+}
+
+// Read history: the file is read in one go and compacted in place into
+// NUL-terminated, whitespace-trimmed commands, so loading is two allocations
+int read_history(History *history) {
+    memset(history, 0, sizeof(*history));
     char *hf = history_file();
     if (!hf) 
         return 0;
@@ -47,29 +81,150 @@ int read_history(HistoryEntry **entries) {
     if (!file) 
         return 0;
 
-    char buffer[MAX_LINE];
-    int count = 0;
-    *entries = malloc(MAX_HISTORY_LINES * sizeof(HistoryEntry));
-    if (!*entries) {
+    struct stat sb;
+    if (fstat(fileno(file), &sb) == -1 || sb.st_size <= 0) {
         fclose(file);
         return 0;
     }
 
-    while (fgets(buffer, sizeof(buffer), file) && count < MAX_HISTORY_LINES) {
-        char *line = trim_whitespace(buffer);
-        if (*line == '\0')
-            continue;
-        (*entries)[count].id = count + 1;
-        (*entries)[count].command = strdup(line);
-        count++;
+    // Offsets are 32-bit; a history beyond that keeps its newest part
+    size_t size = (size_t)sb.st_size;
+    if (size > HISTORY_ARENA_MAX - 1) {
+        fseeko(file, (off_t)(size - (HISTORY_ARENA_MAX - 1)), SEEK_SET);
+        size = HISTORY_ARENA_MAX - 1;
     }
-
+    char *arena = malloc(size + 1);
+    if (!arena) {
+        fclose(file);
+        return 0;
+    }
+    size = fread(arena, 1, size, file);
     fclose(file);
+    arena[size] = '\n';
+
+    int lines = 0;
+    for (const char *p = arena; (p = memchr(p, '\n', size + 1 - (size_t)(p - arena))) != NULL; p++)
+        lines++;
+
+    HistoryEntry *entries = malloc(lines * sizeof(HistoryEntry));
+    if (!entries) {
+        free(arena);
+        return 0;
+    }
+
+    size_t out = 0;
+    int count = 0;
+    const char *line = arena, *end = arena + size;
+    while (line < end) {
+        const char *nl = memchr(line, '\n', (size_t)(end - line) + 1);
+        const char *first = line, *last = nl;
+        while (first < last && own_isspace((unsigned char)*first))
+            first++;
+        while (last > first && own_isspace((unsigned char)last[-1]))
+            last--;
+
+        if (last > first) {
+            size_t len = (size_t)(last - first);
+            memmove(arena + out, first, len);
+            arena[out + len] = '\0';
+            entries[count].offset = (uint32_t)out;
+            entries[count].len = (uint32_t)len;
+            count++;
+            out += len + 1;
+        }
+        line = nl + 1;
+    }
+
+    history->arena = arena;
+    history->arena_len = out;
+    history->arena_cap = size + 1;
+    history->entries = entries;
+    history->count = count;
+    history->cap = lines;
     return count;
 }
 
+// Session history used for line editing, read from disk on first use
+static History session = {0};
+static bool session_loaded = false;
+
+static const char *session_text(int index) {
+    return history_command(&session, index);
+}
+
+static void history_load(void) {
+    if (session_loaded)
+        return;
+    session_loaded = true;
+    // entries other sessions share from here on are not in the file yet
+    shared_history_mark();
+    read_history(&session);
+
+    // oldest first, so the newest entry ends up as each prefix's suggestion
+    suggest_init(session_text);
+    for (int i = 0; i < session.count; i++)
+        suggest_insert(i);
+}
+
+bool history_loaded(void) {
+    return session_loaded;
+}
+
+void history_preload(void) {
+    history_load();
+}
+
+int history_size(void) {
+    history_load();
+    return session.count;
+}
+
+const char *history_at(int index) {
+    history_load();
+    if (index < 0 || index >= session.count)
+        return NULL;
+    return history_command(&session, index);
+}
+
+const char *history_suggest(const char *prefix) {
+    // Called per keystroke: never pay for reading the file here, the line
+    // editor preloads it while idle and UP loads it on demand
+    if (!session_loaded)
+        return NULL;
+    int index = suggest_lookup(prefix);
+    return index < 0 ? NULL : history_command(&session, index);
+}
+
+static int session_push(const char *command) {
+    if (history_push(&session, command, strlen(command)) != HERMES_SUCCESS)
+        return HERMES_FAILURE;
+    suggest_insert(session.count - 1);
+    return HERMES_SUCCESS;
+}
+
+static void session_push_shared(const char *command) {
+    session_push(command);
+}
+
+void history_sync(void) {
+    history_load();
+    shared_history_pull(session_push_shared);
+}
+
+int history_add(const char *command) {
+    int result = append_to_history(command);
+    if (result != HERMES_SUCCESS)
+        return result;
+    shared_history_publish(command);
+
+    // Not loaded yet: the next history_load() will pick it up from disk
+    if (!session_loaded)
+        return HERMES_SUCCESS;
+    return session_push(command);
+}
+
 // Write history
-static int write_history(HistoryEntry *entries, int count) {
+static int write_history(const History *history) {
     char *hf = history_file();
     if (!hf)
         return HERMES_FAILURE;
@@ -77,19 +232,14 @@ static int write_history(HistoryEntry *entries, int count) {
     free(hf);
     if (!file)
         return HERMES_FAILURE;
-    for (int i = 0; i < count; i++)
-        fprintf(file, "%s\n", entries[i].command);
+    for (int i = 0; i < history->count; i++) {
+        fwrite(history_command(history, i), 1, history->entries[i].len, file);
+        fputc('\n', file);
+    }
     fclose(file);
     return HERMES_SUCCESS;
 }
 
-// Free history
-static void free_history(HistoryEntry *entries, int count) {
-    for (int i = 0; i < count; i++)
-        free(entries[i].command);
-    free(entries);
-}
-
 // Check number
 static int is_number(const char *str) {
     if (!str || !*str)
@@ -102,54 +252,75 @@ static int is_number(const char *str) {
     return 1;
 }
 
+// Entry whose command contains arena offset pos
+static int entry_at(const History *history, size_t pos) {
+    int lo = 0, hi = history->count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (history->entries[mid].offset <= pos) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+static bool entry_contains(const History *history, int index, const char *const *filters, int filter_count) {
+    const char *command = history_command(history, index);
+    for (int j = 0; j < filter_count; j++)
+        if (!filters[j] || !memmem(command, history->entries[index].len, filters[j], strlen(filters[j])))
+            return false;
+    return true;
+}
+
 // Print history with optional filters
-static void print_history(HistoryEntry *entries, int count, const char *const *filters, int filter_count, int start_id, int end_id) {
-    for (int i = 0; i < count; i++) {
-        if (start_id > 0 && end_id > 0 && (entries[i].id < start_id || entries[i].id > end_id))
+static void print_history(const History *history, const char *const *filters, int filter_count, int start_id, int end_id) {
+    if (filter_count == 0 || !filters[0] || !*filters[0]) {
+        for (int i = 0; i < history->count; i++) {
+            if (start_id > 0 && end_id > 0 && (i + 1 < start_id || i + 1 > end_id))
+                continue;
+            if (filter_count > 0 && !entry_contains(history, i, filters, filter_count))
+                continue;
+            printf("%5d  %s\n", i + 1, history_command(history, i));
+        }
+        return;
+    }
+
+    // Stream the first filter through the whole arena; commands are NUL
+    // separated, so a hit never spans two entries
+    const char *arena = history->arena;
+    size_t first_len = strlen(filters[0]);
+    size_t pos = 0;
+    const char *hit;
+    while (pos < history->arena_len &&
+           (hit = memmem(arena + pos, history->arena_len - pos, filters[0], first_len)) != NULL) {
+        int i = entry_at(history, (size_t)(hit - arena));
+        pos = history->entries[i].offset + history->entries[i].len + 1;
+        if (start_id > 0 && end_id > 0 && (i + 1 < start_id || i + 1 > end_id))
             continue;
-        if (filter_count == 0) {
-            printf("%5d  %s\n", entries[i].id, entries[i].command);
+        if (!entry_contains(history, i, filters + 1, filter_count - 1))
             continue;
-        }
-        int match = 1;
-        for (int j = 0; j < filter_count; j++)
-            if (!filters[j] || !strstr(entries[i].command, filters[j])) {
-                match = 0;
-                break;
-            }
-        if (match) 
-            printf("%5d  %s\n", entries[i].id, entries[i].command);
+        printf("%5d  %s\n", i + 1, history_command(history, i));
     }
 }
 
 // Delete entries
-static int delete_entries(HistoryEntry **entries, int *count, const char *const *filters, int filter_count, int start_id, int end_id) {
+static int delete_entries(History *history, const char *const *filters, int filter_count, int start_id, int end_id) {
     int new_count = 0, deleted = 0;
-    for (int i = 0; i < *count; i++) {
+    for (int i = 0; i < history->count; i++) {
         int should_delete = 0;
         if (start_id > 0 && end_id > 0)
-            should_delete = ((*entries)[i].id >= start_id && (*entries)[i].id <= end_id);
-        else if (filter_count > 0) {
-            should_delete = 1;
-            for (int j = 0; j < filter_count; j++)
-                if (!strstr((*entries)[i].command, filters[j])) {
-                    should_delete = 0;
-                    break;
-                }
-        }
-        if (should_delete) {
-            free((*entries)[i].command);
+            should_delete = (i + 1 >= start_id && i + 1 <= end_id);
+        else if (filter_count > 0)
+            should_delete = entry_contains(history, i, filters, filter_count);
+        if (should_delete)
             deleted++;
-        }
         else { 
             if (new_count != i)
-                (*entries)[new_count] = (*entries)[i];
-            (*entries)[new_count].id = new_count + 1;
+                history->entries[new_count] = history->entries[i];
             new_count++;
         }
     }
-    *count = new_count;
-    int result = write_history(*entries, *count);
+    history->count = new_count;
+    int result = write_history(history);
     return result == HERMES_SUCCESS ? deleted : result;
 }
 
@@ -253,12 +424,12 @@ int builtin_history(String *args) {
         }
     }
 
-    HistoryEntry *entries = NULL;
-    int count = read_history(&entries);
+    History history;
+    read_history(&history);
 
     if (delete_mode) {
-        int result = delete_entries(&entries, &count, filters, filter_count, start_id, end_id);
-        free_history(entries, count);
+        int result = delete_entries(&history, filters, filter_count, start_id, end_id);
+        free_history(&history);
         if (filters)
             free(filters);
 
@@ -266,17 +437,17 @@ int builtin_history(String *args) {
     }
 
     if (range_mode) 
-        print_history(entries, count, NULL, 0, start_id, end_id);
+        print_history(&history, NULL, 0, start_id, end_id);
     else if (start_id > 0) 
-        print_history(entries, count, NULL, 0, start_id, start_id);
+        print_history(&history, NULL, 0, start_id, start_id);
     else if (filter_count > 0) 
-        print_history(entries, count, filters, filter_count, 0, 0);
+        print_history(&history, filters, filter_count, 0, 0);
     else 
-        print_history(entries, count, NULL, 0, 0, 0);
+        print_history(&history, NULL, 0, 0, 0);
 
     if (filters) 
         free(filters);
 
-    free_history(entries, count);
+    free_history(&history);
     return HERMES_SUCCESS;
 }
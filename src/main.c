@@ -1,18 +1,44 @@
 #include <string.h>
 #include <unistd.h>
 #include <limits.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
 #include "globals.h"
+#include "alias.h"
+#include "ast.h"
 #include "builtins.h"
+#include "cache.h"
+#include "frecency.h"
+#include "parallel.h"
+#include "path.h"
+#include "policy.h"
+#include "shared_history.h"
+#include "stats.h"
+
+#define HISTORY_IDLE_MS 50      // a pause this long at the prompt counts as idle
 
 const char *name = "hermes";
 struct termios orig_termios;
 
 static char PROMPT[MAX_LINE] = "\r$ ";
+static const char *line_prompt = PROMPT;   // "> " while a compound command is open
+
+typedef enum LineEnd {
+    LINE_ENTER,
+    LINE_CANCEL,        // Ctrl-C: drop the line and anything still open
+    LINE_EOF,           // Ctrl-D on an empty continuation line
+} LineEnd;
+
+static LineEnd line_end = LINE_ENTER;   // how the last read_line() finished
 
 static pid_t fg_pid = -1;        // current foreground process
 static pid_t shell_pgid = -1;    // shell's process group id
 
+static bool profile_startup = false;
+static struct timespec startup_mark;
+
 static void die(const int code) {
     perror(name);
     exit(code);
@@ -24,13 +50,39 @@ static void sigint_handler(int sig) {
         // send to the process group so all children in that group get it 
         kill(-fg_pid, SIGINT);
     }
+    parallel_signal(SIGINT);
+    ast_interrupt();
+}
+
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) * 1e3 + (double)(now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+// Report the time since the previous phase when --profile-startup is given
+static void startup_phase(const char *phase) {
+    if (!profile_startup) return;
+    static double total = 0;
+    double ms = elapsed_ms(&startup_mark);
+    total += ms;
+    fprintf(stderr, "startup: %-12s %8.3f ms  (total %.3f ms)\n", phase, ms, total);
+    clock_gettime(CLOCK_MONOTONIC, &startup_mark);
+}
+
+// Default launch policy for every external command
+static void config_policy(const char *path, const char *key, const char *option, const char *val) {
+    if (!policy_option(policy_defaults(), option, val))
+        fprintf(stderr, "%s: invalid %s=%s\n", path, key, val);
 }
 
 void load_config(const char *path) {
     FILE *file = fopen(path, "r");
     if (!file) {
-        fprintf(stderr, "Failed to open config file: %s: %s\n", path, strerror(errno));
-        exit(EXIT_FAILURE);
+        // no config file is the common case, anything else is worth a warning
+        if (errno != ENOENT)
+            fprintf(stderr, "Failed to open config file: %s: %s\n", path, strerror(errno));
+        return;
     }
 
     char line[MAX_LINE];
@@ -38,6 +90,7 @@ void load_config(const char *path) {
         line[strcspn(line, "\r\n")] = '\0';
 
         if (line[0] == '\0' || line[0] == '#') continue;
+        if (alias_config(line)) continue;
         char *eq = strchr(line, '=');
         if (!eq) continue;
 
@@ -46,6 +99,13 @@ void load_config(const char *path) {
         char *val = eq + 1;
 
         if (strcmp(key, "PROMPT") == 0) strncat(PROMPT, val, MAX_LINE - 1);
+        else if (strcmp(key, "TRACE") == 0) stats_set_trace(val);
+        else if (strcmp(key, "SHARE_HISTORY") == 0) shared_history_enable(strcmp(val, "0") != 0);
+        else if (strcmp(key, "NICE") == 0) config_policy(path, key, "nice", val);
+        else if (strcmp(key, "CPUS") == 0) config_policy(path, key, "cpus", val);
+        else if (strcmp(key, "IOPRIO") == 0) config_policy(path, key, "ioprio", val);
+        else if (strcmp(key, "CACHE_SIZE") == 0 && !cache_set_max(val))
+            fprintf(stderr, "%s: invalid %s=%s\n", path, key, val);
     }
     fclose(file);
 }
@@ -67,6 +127,162 @@ void enableRawMode(void) {
 }
 
 
+// Executables on $PATH, collected on the first TAB and reused until $PATH
+// or the mtime of one of its directories changes
+typedef struct PathCache {
+    char *path_env;
+    struct timespec *mtimes;
+    int dir_count;
+    char **names;
+    int count;
+} PathCache;
+
+static PathCache path_cache = {0};
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool path_cache_stale(const char *path_env) {
+    if (!path_cache.path_env || strcmp(path_cache.path_env, path_env) != 0)
+        return true;
+
+    char *copy = strdup(path_env);
+    if (!copy) return true;
+    bool stale = false;
+    int i = 0;
+    for (char *dirp = strtok(copy, ":"); dirp; dirp = strtok(NULL, ":"), i++) {
+        struct stat sb;
+        struct timespec mtime = {0};
+        if (stat(dirp, &sb) == 0) mtime = sb.st_mtim;
+        if (i >= path_cache.dir_count ||
+            mtime.tv_sec != path_cache.mtimes[i].tv_sec ||
+            mtime.tv_nsec != path_cache.mtimes[i].tv_nsec) {
+            stale = true;
+            break;
+        }
+    }
+    free(copy);
+    return stale;
+}
+
+static void path_cache_rebuild(const char *path_env) {
+    for (int i = 0; i < path_cache.count; i++)
+        free(path_cache.names[i]);
+    free(path_cache.names);
+    free(path_cache.mtimes);
+    free(path_cache.path_env);
+    memset(&path_cache, 0, sizeof(path_cache));
+
+    path_cache.path_env = strdup(path_env);
+    char *copy = strdup(path_env);
+    if (!path_cache.path_env || !copy) {
+        die(EXIT_FAILURE);
+    }
+
+    int dirs = 1;
+    for (const char *p = path_env; *p; p++)
+        if (*p == ':') dirs++;
+    path_cache.mtimes = calloc(dirs, sizeof(struct timespec));
+    if (!path_cache.mtimes) {
+        die(EXIT_FAILURE);
+    }
+
+    int cap = 256;
+    path_cache.names = malloc(cap * sizeof(char *));
+    if (!path_cache.names) {
+        die(EXIT_FAILURE);
+    }
+
+    for (char *dirp = strtok(copy, ":"); dirp; dirp = strtok(NULL, ":")) {
+        struct stat sb;
+        if (stat(dirp, &sb) == 0)
+            path_cache.mtimes[path_cache.dir_count] = sb.st_mtim;
+        path_cache.dir_count++;
+
+        DIR *d = opendir(dirp);
+        if (!d) continue;
+
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.' && (de->d_name[1] == '\0' || strcmp(de->d_name, "..") == 0))
+                continue;
+
+            char fullpath[PATH_MAX];
+            snprintf(fullpath, sizeof(fullpath), "%s/%s", dirp, de->d_name);
+            if (access(fullpath, X_OK) != 0)
+                continue;
+
+            if (path_cache.count == cap) {
+                cap *= 2;
+                path_cache.names = realloc(path_cache.names, cap * sizeof(char *));
+                if (!path_cache.names) {
+                    die(EXIT_FAILURE);
+                }
+            }
+            path_cache.names[path_cache.count++] = strdup(de->d_name);
+        }
+        closedir(d);
+    }
+    free(copy);
+
+    qsort(path_cache.names, path_cache.count, sizeof(char *), compare_names);
+    int uniq = 0;
+    for (int i = 0; i < path_cache.count; i++) {
+        if (uniq > 0 && strcmp(path_cache.names[i], path_cache.names[uniq - 1]) == 0)
+            free(path_cache.names[i]);
+        else
+            path_cache.names[uniq++] = path_cache.names[i];
+    }
+    path_cache.count = uniq;
+}
+
+// First index whose name is >= prefix; all completions follow contiguously
+static int path_cache_lower_bound(const char *prefix) {
+    int lo = 0, hi = path_cache.count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(path_cache.names[mid], prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+typedef struct RankedDir {
+    char *chars;
+    double score;
+} RankedDir;
+
+static int compare_ranked(const void *a, const void *b) {
+    const RankedDir *x = a, *y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return strcmp(x->chars, y->chars);
+}
+
+// Order cd candidates by frecency so frequently visited directories come first
+static void rank_dirs(String *matches, int count) {
+    char cwd[PATH_MAX];
+    RankedDir *ranked = malloc(count * sizeof(*ranked));
+    if (!ranked || !getcwd(cwd, sizeof(cwd))) {
+        free(ranked);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char *cand = matches[i].chars;
+        char full[PATH_MAX * 2];
+        if (strncmp(cand, "./", 2) == 0) cand += 2;
+        if (cand[0] == '/') snprintf(full, sizeof(full), "%s", cand);
+        else snprintf(full, sizeof(full), "%s/%s", cwd, cand);
+        ranked[i].chars = matches[i].chars;
+        ranked[i].score = frecency_score(full);
+    }
+    qsort(ranked, count, sizeof(*ranked), compare_ranked);
+    for (int i = 0; i < count; i++)
+        matches[i].chars = ranked[i].chars;
+    free(ranked);
+}
+
 String handle_tab(String buffer) {
     int cap = 16, count = 0;
     String *matches = malloc(cap * sizeof(*matches));
@@ -91,9 +307,10 @@ String handle_tab(String buffer) {
     int first_token = !last_space;
 
     if (first_token) {
-        // Complete builtins + executables in PATH
-        for (int b = 0; b < builtin_str_count; b++) {
-            if (strncmp(builtin_str[b], token_start, token_len) == 0) {
+        // Complete builtins, the with/cache prefixes + executables in PATH
+        for (int b = 0; b < builtin_str_count + prefix_str_count; b++) {
+            const char *word = b < builtin_str_count ? builtin_str[b] : prefix_str[b - builtin_str_count];
+            if (strncmp(word, token_start, token_len) == 0) {
                 if (count == cap) {
                     cap *= 2;
                     matches = realloc(matches, cap * sizeof(*matches));
@@ -101,48 +318,29 @@ String handle_tab(String buffer) {
                         die(EXIT_FAILURE);
                     }
                 }
-                matches[count].chars = strdup(builtin_str[b]);
+                matches[count].chars = strdup(word);
                 count++;
             }
         }
 
         char *path_env = getenv("PATH");
         if (path_env) {
-            char *path_copy = strdup(path_env);
-            if (!path_copy) {
-                die(EXIT_FAILURE);
-            }
-
-            for (char *dirp = strtok(path_copy, ":"); dirp; dirp = strtok(NULL, ":")) {
-                DIR *d = opendir(dirp);
-                if (!d) continue;
+            if (path_cache_stale(path_env))
+                path_cache_rebuild(path_env);
 
-                struct dirent *de;
-                while ((de = readdir(d)) != NULL) {
-                    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
-                        continue;
-
-                    if (strncmp(de->d_name, token_start, token_len) == 0) {
-                        char fullpath[PATH_MAX];
-                        snprintf(fullpath, sizeof(fullpath), "%s/%s", dirp, de->d_name);
-                        if (access(fullpath, X_OK) == 0) {
-                            if (count == cap) {
-                                cap *= 2;
-                                matches = realloc(matches, cap * sizeof(*matches));
-                                if (!matches) {
-                                    closedir(d);
-                                    free(path_copy);
-                                    die(EXIT_FAILURE);
-                                }
-                            }
-                            matches[count].chars = strdup(de->d_name);
-                            count++;
-                        }
+            for (int p = path_cache_lower_bound(token_start); p < path_cache.count; p++) {
+                if (strncmp(path_cache.names[p], token_start, token_len) != 0)
+                    break;
+                if (count == cap) {
+                    cap *= 2;
+                    matches = realloc(matches, cap * sizeof(*matches));
+                    if (!matches) {
+                        die(EXIT_FAILURE);
                     }
                 }
-                closedir(d);
+                matches[count].chars = strdup(path_cache.names[p]);
+                count++;
             }
-            free(path_copy);
         }
     } else {
         // Split token_start into dir and base parts
@@ -223,6 +421,8 @@ String handle_tab(String buffer) {
         buffer.chars = new_buf;
         buffer.len = (int)new_len;
     } else if (count > 1) {
+        if (complete_dirs_only)
+            rank_dirs(matches, count);
         printf("\n");
         for (int i = 0; i < count; i++) {
             printf("%s\t", matches[i].chars);
@@ -237,37 +437,58 @@ String handle_tab(String buffer) {
     return buffer;
 }
 
-String read_line(HistoryEntry *history, int history_count) {
+/*
+ * One byte of input. Until history is loaded, wait briefly first: if the
+ * user is not typing, load it then, so suggestions are ready without the
+ * file ever being read at startup or in response to a keystroke.
+ */
+static ssize_t read_key(chars_t *c) {
+    if (!history_loaded()) {
+        struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+        if (poll(&pfd, 1, HISTORY_IDLE_MS) == 0)
+            history_preload();
+    }
+    return read(STDIN_FILENO, c, 1);
+}
+
+String read_line(void) {
     String buffer = {.chars = calloc(BUFFER_MAX_SIZE, 1), .len = 0};
     if (!buffer.chars) {
         die(EXIT_FAILURE);
     }
 
     int cursor = 0;            // current cursor position in buffer
-    int history_index = history_count; // start at "after last entry"
-    chars_t c;
+    int history_index = -1;    // -1 until UP is first pressed, then "after last entry"
+    chars_t c = 0;             // read() fills only the low byte
+    const char *suggestion = NULL; // history entry extending the buffer, drawn dimmed
+    line_end = LINE_ENTER;
 
-    while (read(STDIN_FILENO, &c, 1) == 1 && c != ENTER) {
+    while (read_key(&c) == 1 && c != ENTER) {
         if (c == ESCAPE) {
             read(STDIN_FILENO, &c, 1);
             if (c == '[') {
                 read(STDIN_FILENO, &c, 1);
                 switch (c) {
                 case 'A': // UP
-                    if (history_count == 0) break;
+                    // history is only read from disk once it is first needed,
+                    // then topped up with what other sessions ran since
+                    if (history_index < 0) {
+                        history_sync();
+                        history_index = history_size();
+                    }
                     if (history_index > 0) history_index--;
                     else break;
-                    buffer.len = snprintf(buffer.chars, BUFFER_MAX_SIZE, "%s", history[history_index].command);
+                    buffer.len = snprintf(buffer.chars, BUFFER_MAX_SIZE, "%s", history_at(history_index));
                     cursor = buffer.len;
                     break;
 
                 case 'B': // DOWN
-                    if (history_count == 0) break;
-                    if (history_index < history_count - 1) {
+                    if (history_index < 0) break;
+                    if (history_index < history_size() - 1) {
                         history_index++;
-                        buffer.len = snprintf(buffer.chars, BUFFER_MAX_SIZE, "%s", history[history_index].command);
+                        buffer.len = snprintf(buffer.chars, BUFFER_MAX_SIZE, "%s", history_at(history_index));
                     } else {
-                        history_index = history_count;
+                        history_index = history_size();
                         buffer.len = 0;
                         buffer.chars[0] = '\0';
                     }
@@ -277,6 +498,11 @@ String read_line(HistoryEntry *history, int history_count) {
                 case 'C': // RIGHT
                     if (cursor < buffer.len) 
                         cursor++;
+                    else if (suggestion) {
+                        buffer.len = snprintf(buffer.chars, BUFFER_MAX_SIZE, "%s", suggestion);
+                        if (buffer.len >= BUFFER_MAX_SIZE) buffer.len = BUFFER_MAX_SIZE - 1;
+                        cursor = buffer.len;
+                    }
                     break;
 
                 case 'D': // LEFT
@@ -292,7 +518,18 @@ String read_line(HistoryEntry *history, int history_count) {
                 buffer.chars[buffer.len] = '\0';
                 cursor--;
             }
+        } else if (c == CTRL_C) {
+            // raw mode has ISIG off, so this arrives as a byte, not a signal
+            buffer.len = 0;
+            printf("^C");
+            line_end = LINE_CANCEL;
+            break;
         } else if (c == CTRL_D) {
+            if (buffer.len == 0 && line_prompt != PROMPT) {
+                // ends the open construct, not the shell
+                line_end = LINE_EOF;
+                break;
+            }
             if (buffer.len == 0) {
                 printf("\n");
                 disableRawMode();
@@ -310,10 +547,19 @@ String read_line(HistoryEntry *history, int history_count) {
             }
         }
 
+        // only suggest at the end of the line, where RIGHT can accept it
+        suggestion = NULL;
+        if (buffer.len > 0 && cursor == buffer.len) {
+            suggestion = history_suggest(buffer.chars);
+            if (suggestion && suggestion[buffer.len] == '\0') suggestion = NULL;
+        }
+
         // redraw line
-        printf("\r%s%s\033[K", PROMPT, buffer.chars);
+        printf("\r%s%s", line_prompt, buffer.chars);
+        if (suggestion) printf("\033[90m%s\033[0m", suggestion + buffer.len);
+        printf("\033[K");
         // move cursor to correct position
-        printf("\r%s", PROMPT);
+        printf("\r%s", line_prompt);
         if (cursor > 0) printf("\033[%dC", cursor);
         fflush(stdout);
     }
@@ -323,31 +569,46 @@ String read_line(HistoryEntry *history, int history_count) {
     return buffer;
 }
 
-int parse_line(String line, String **out) {
-    char *token_str = strtok(line.chars, PARSE_TOKEN_DELIM);
-    String token = {.chars = token_str, .len = token_str ? (int)strlen(token_str) : 0};
-    String *buffer = malloc(sizeof(String) * BUFFER_MAX_SIZE);
-    if (!buffer) {
+// Append another line to a command whose compound part is still open
+static String read_continuation(String line) {
+    line_prompt = "\r> ";
+    printf("%s", line_prompt);
+    fflush(stdout);
+    String more = read_line();
+    line_prompt = PROMPT;
+    if (line_end != LINE_ENTER) {
+        free(more.chars);
+        return line;
+    }
+
+    char *joined = realloc(line.chars, line.len + more.len + 2);
+    if (!joined) {
         die(EXIT_FAILURE);
     }
-    int i = 0;
+    joined[line.len] = '\n';
+    memcpy(joined + line.len + 1, more.chars, more.len + 1);
+    line.chars = joined;
+    line.len += more.len + 1;
+    free(more.chars);
+    return line;
+}
 
-    while (token.chars != NULL) {
-        switch (token.chars[0]) {
-        case '$':
-            token.chars = getenv(token.chars + 1);
-            break;
+// History is line based; the parser reads "; " wherever a newline may go
+static char *history_form(char *command) {
+    static char flat[BUFFER_MAX_SIZE * 2];
+    if (!strchr(command, '\n')) return command;
+
+    size_t n = 0;
+    for (const char *c = command; *c && n < sizeof(flat) - 3; c++) {
+        if (*c == '\n') {
+            flat[n++] = ';';
+            flat[n++] = ' ';
+        } else {
+            flat[n++] = *c;
         }
-        buffer[i].chars = token.chars;
-        buffer[i].len = token.len;
-        token_str = strtok(NULL, PARSE_TOKEN_DELIM);
-        token.chars = token_str;
-        token.len = token_str ? (int)strlen(token_str) : 0;
-        i++;
     }
-
-    *out = buffer;
-    return i;
+    flat[n] = '\0';
+    return flat;
 }
 
 char **to_argv(String *args, int count) {
@@ -363,19 +624,14 @@ char **to_argv(String *args, int count) {
 }
 
 // launch child in its own process group, wait robustly 
-int launch(String *args, int argc) {
+int launch_with(String *args, int argc, const LaunchPolicy *policy) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     pid_t pid = fork();
     if (pid == 0) {
         /* child */
-        if (setpgid(0, 0) < 0) { /* ignore errors - best effort */ }
-
-        /* Restore default signal handlers in child (optional, but good) */
-        signal(SIGINT, SIG_DFL);
-        signal(SIGQUIT, SIG_DFL);
-        signal(SIGTSTP, SIG_DFL);
-        signal(SIGTTIN, SIG_DFL);
-        signal(SIGTTOU, SIG_DFL);
-
+        policy_child_setup(policy);
         char **argv = to_argv(args, argc);
         execvp(argv[0], argv);
 
@@ -383,6 +639,7 @@ int launch(String *args, int argc) {
         _exit(127);
     } else if (pid < 0) {
         perror(name);
+        stats_record(args, argc, 1, false, &start, NULL);
         return -1;
     } else {
         /* parent */
@@ -408,9 +665,10 @@ int launch(String *args, int argc) {
         signal(SIGTTIN, old_ttin);
 
         int status;
+        struct rusage usage;
         pid_t w;
         do {
-            w = waitpid(pid, &status, WUNTRACED);
+            w = wait4(pid, &status, WUNTRACED, &usage);
         } while (w == -1 && errno == EINTR);
 
         /* if child was stopped (SIGTSTP), consider job control handling here.
@@ -427,19 +685,71 @@ int launch(String *args, int argc) {
 
         fg_pid = -1;
 
-        if (w == -1) return -1;
-        if (WIFEXITED(status)) return WEXITSTATUS(status);
-        if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
-        if (WIFSTOPPED(status)) return 128 + WSTOPSIG(status);
-        return -1;
+        int result = -1;
+        if (w == -1) result = -1;
+        else if (WIFEXITED(status)) result = WEXITSTATUS(status);
+        else if (WIFSIGNALED(status)) result = 128 + WTERMSIG(status);
+        else if (WIFSTOPPED(status)) result = 128 + WSTOPSIG(status);
+
+        /* Ctrl-C went to the child's group, not to sigint_handler; stop
+           the loop or list this command ran in, as if the shell got it */
+        if (w != -1 && WIFSIGNALED(status) && WTERMSIG(status) == SIGINT)
+            ast_interrupt();
+
+        stats_record(args, argc, result < 0 ? 1 : result, false, &start, w == -1 ? NULL : &usage);
+        return result;
     }
 }
 
-int execute(String *args, int argc) {
+int launch(String *args, int argc) {
+    return launch_with(args, argc, policy_defaults());
+}
+
+static void rusage_delta(struct rusage *after, const struct rusage *before) {
+    timersub(&after->ru_utime, &before->ru_utime, &after->ru_utime);
+    timersub(&after->ru_stime, &before->ru_stime, &after->ru_stime);
+    after->ru_minflt -= before->ru_minflt;
+    after->ru_majflt -= before->ru_majflt;
+    after->ru_nvcsw -= before->ru_nvcsw;
+    after->ru_nivcsw -= before->ru_nivcsw;
+}
+
+static int execute_with(String *args, int argc, const LaunchPolicy *policy) {
     if (args[0].chars == NULL || argc == 0) {
         return 1;
     }
 
+    // with [options] -- cmd: run cmd under an overriding launch policy
+    if (strcmp(args[0].chars, "with") == 0) {
+        LaunchPolicy override = *policy;
+        int cmd = policy_parse_with(args, argc, &override);
+        if (cmd < 0) {
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            stats_record(args, argc, 2, true, &start, NULL);
+            return 2;
+        }
+        return execute_with(args + cmd, argc - cmd, &override);
+    }
+
+    // cache [options] -- cmd: replay a stored result or run and store it
+    if (strcmp(args[0].chars, "cache") == 0)
+        return cache_run(args, argc, policy);
+
+    // Aliases expand their pre-parsed words in front of the arguments
+    String *expanded;
+    int expanded_count;
+    Alias *alias = alias_begin(args, argc, &expanded, &expanded_count);
+    if (alias) {
+        int status = execute_with(expanded, expanded_count, policy);
+        alias_end(alias, expanded);
+        return status;
+    }
+
+    int status;
+    if (ast_call(args, argc, &status))
+        return status;
+
     for (int i = 0; i < builtin_str_count; i++) {
         if (strcmp(args[0].chars, builtin_str[i]) == 0) {
             // For builtin commands, a proper NULL-terminated array is needed
@@ -453,25 +763,46 @@ int execute(String *args, int argc) {
             }
             cmd_args[argc].chars = NULL;
 
-            int result = (*builtin_func[i])(cmd_args);
+            struct timespec start;
+            struct rusage before, after;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            getrusage(RUSAGE_SELF, &before);
+
+            int result = (*builtin_func[i])(cmd_args) == HERMES_SUCCESS ? 0 : 1;
+
+            getrusage(RUSAGE_SELF, &after);
+            rusage_delta(&after, &before);
+            stats_record(args, argc, result, true, &start, &after);
             free(cmd_args);
             return result;
         }
     }
 
-    return launch(args, argc);
+    return launch_with(args, argc, policy);
+}
+
+// Run a builtin or external command; returns the exit status $? reports
+int execute(String *args, int argc) {
+    int status = execute_with(args, argc, policy_defaults());
+    // launch_with() gives -1 when the command could not be run; stats has 1
+    return status < 0 ? 1 : status;
 }
 
 int main(int argc, char **argv) {
-    if (access(CONFIG_FILE, F_OK) == 0) {
-        load_config(CONFIG_FILE);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile-startup") == 0)
+            profile_startup = true;
     }
+    clock_gettime(CLOCK_MONOTONIC, &startup_mark);
 
-    name = strdup(argv[0]);
+    char *config = path_xdg("XDG_CONFIG_HOME", ".config", "hermes.conf");
+    if (config) {
+        load_config(config);
+        free(config);
+    }
+    startup_phase("config");
 
-    // Load history
-    HistoryEntry *history = NULL;
-    int history_count = read_history(&history);
+    name = strdup(argv[0]);
 
     signal(SIGINT, sigint_handler); // enables SIGINT to kill child
     /* in main(), after signal(SIGINT, sigint_handler); and before prompt loop */
@@ -482,9 +813,12 @@ int main(int argc, char **argv) {
     }
     /* Ensure the shell is foreground of the terminal (best-effort) */
     tcsetpgrp(STDIN_FILENO, shell_pgid);
+    startup_phase("signals");
 
     chdir(getenv("HOME"));
+    startup_phase("chdir");
 
+    // History and completion caches are loaded on first use (UP, TAB)
     printf("\x1b[2J"); // clear screen
     while (true) {
         printf("\x1b[H\x1b[90B"); // move cursor
@@ -495,38 +829,46 @@ int main(int argc, char **argv) {
 
         enableRawMode();
 
-        // Pass the history buffer to the line reader
-        String line = read_line(history, history_count);
+        if (profile_startup) {
+            startup_phase("first prompt");
+            profile_startup = false;
+            printf("%s", PROMPT);
+            fflush(stdout);
+        }
+
+        String line = read_line();
+
+        // Keep reading while an if, loop or function body is still open
+        Node *tree = NULL;
+        AstStatus parsed = AST_OK;
+        while (line_end == LINE_ENTER && (parsed = ast_parse(line.chars, &tree)) == AST_INCOMPLETE)
+            line = read_continuation(line);
+
+        if (line_end == LINE_CANCEL) {
+            disableRawMode();
+            free(line.chars);
+            continue;
+        }
 
         // Append new line to history
         if (line.len > 0) {
-            append_to_history(line.chars);
-
-            // Add to in-memory array for immediate navigation
-            history = realloc(history, (history_count + 1) * sizeof(HistoryEntry));
-            history[history_count].command = strdup(line.chars);
-            history_count++;
+            history_add(history_form(line.chars));
         }
 
         printf("\x1b[2J\x1b[H"); // clear screen again
         fflush(stdout);
 
-        String *args;
-        int argc = parse_line(line, &args);
-        if (argc > 0)  {
-            disableRawMode();
-            execute(args, argc);
-        }
+        disableRawMode();
+        if (parsed == AST_ERROR)
+            fprintf(stderr, "%s: %s\n", name, ast_error());
+        else if (parsed == AST_INCOMPLETE)
+            fprintf(stderr, "%s: syntax error: unexpected end of input\n", name);
+        ast_eval(tree);
+        ast_free(tree);
 
         free(line.chars);
-        free(args);
     }
 
-    // Cleanup
-    for (int i = 0; i < history_count; i++) {
-        free(history[i].command);
-    }
-    free(history);
     free(name);
 
     return 0;
@@ -0,0 +1,116 @@
+#include "map.h"
+
+#define MAP_INITIAL_BUCKETS 16
+
+static unsigned hash_key(const char *key) {
+    unsigned h = 2166136261u;
+    for (; *key; key++) {
+        h ^= (unsigned char)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static MapEntry **find(const Map *map, const char *key, unsigned hash) {
+    MapEntry **link = &map->buckets[hash & (map->bucket_count - 1)];
+    while (*link && ((*link)->hash != hash || strcmp((*link)->key, key) != 0))
+        link = &(*link)->next;
+    return link;
+}
+
+static bool grow(Map *map) {
+    int count = map->bucket_count ? map->bucket_count * 2 : MAP_INITIAL_BUCKETS;
+    MapEntry **buckets = calloc(count, sizeof(MapEntry *));
+    if (!buckets) return false;
+
+    for (int i = 0; i < map->bucket_count; i++) {
+        MapEntry *e = map->buckets[i];
+        while (e) {
+            MapEntry *next = e->next;
+            MapEntry **head = &buckets[e->hash & (count - 1)];
+            e->next = *head;
+            *head = e;
+            e = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = buckets;
+    map->bucket_count = count;
+    return true;
+}
+
+void *map_get(const Map *map, const char *key) {
+    if (map->count == 0) return NULL;
+    MapEntry *e = *find(map, key, hash_key(key));
+    return e ? e->value : NULL;
+}
+
+void *map_put(Map *map, const char *key, void *value) {
+    unsigned hash = hash_key(key);
+    if (map->bucket_count) {
+        MapEntry *e = *find(map, key, hash);
+        if (e) {
+            void *old = e->value;
+            e->value = value;
+            return old;
+        }
+    }
+
+    // Keep chains short: at most 3/4 of a bucket per entry on average
+    if ((map->count + 1) * 4 > map->bucket_count * 3 && !grow(map)) {
+        perror(name);
+        return NULL;
+    }
+
+    MapEntry *e = malloc(sizeof(MapEntry));
+    char *copy = strdup(key);
+    if (!e || !copy) {
+        free(e);
+        free(copy);
+        perror(name);
+        return NULL;
+    }
+    e->key = copy;
+    e->value = value;
+    e->hash = hash;
+    MapEntry **head = &map->buckets[hash & (map->bucket_count - 1)];
+    e->next = *head;
+    *head = e;
+    map->count++;
+    return NULL;
+}
+
+void *map_remove(Map *map, const char *key) {
+    if (map->count == 0) return NULL;
+    MapEntry **link = find(map, key, hash_key(key));
+    MapEntry *e = *link;
+    if (!e) return NULL;
+
+    void *value = e->value;
+    *link = e->next;
+    free(e->key);
+    free(e);
+    map->count--;
+    return value;
+}
+
+void map_clear(Map *map, void (*release)(void *value)) {
+    for (int i = 0; i < map->bucket_count; i++) {
+        MapEntry *e = map->buckets[i];
+        while (e) {
+            MapEntry *next = e->next;
+            if (release) release(e->value);
+            free(e->key);
+            free(e);
+            e = next;
+        }
+    }
+    free(map->buckets);
+    memset(map, 0, sizeof(*map));
+}
+
+void map_each(const Map *map, void (*visit)(const char *key, void *value, void *ctx), void *ctx) {
+    for (int i = 0; i < map->bucket_count; i++)
+        for (MapEntry *e = map->buckets[i]; e; e = e->next)
+            visit(e->key, e->value, ctx);
+}
@@ -0,0 +1,37 @@
+#ifndef HERMES_MAP_H
+#define HERMES_MAP_H
+
+#include "globals.h"
+
+/*
+ * String-keyed hash map with separate chaining. A zeroed Map is empty and
+ * ready to use; keys are copied, values are owned by the caller.
+ */
+typedef struct MapEntry {
+    char *key;
+    void *value;
+    unsigned hash;
+    struct MapEntry *next;
+} MapEntry;
+
+typedef struct Map {
+    MapEntry **buckets;
+    int bucket_count;
+    int count;
+} Map;
+
+void *map_get(const Map *map, const char *key);
+
+// Insert or replace; returns the value previously stored under key, if any
+void *map_put(Map *map, const char *key, void *value);
+
+// Returns the removed value, NULL if key was not present
+void *map_remove(Map *map, const char *key);
+
+// Remove every entry, passing each value to release if it is not NULL
+void map_clear(Map *map, void (*release)(void *value));
+
+// Visit every entry in unspecified order
+void map_each(const Map *map, void (*visit)(const char *key, void *value, void *ctx), void *ctx);
+
+#endif
@@ -0,0 +1,405 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include "builtins.h"
+#include "parallel.h"
+#include "policy.h"
+
+#define PARALLEL_MAX_SLOTS 1024
+#define PARALLEL_REAP_MS 50     // recheck interval for exits when pidfds are unavailable
+
+typedef struct JobBuffer {
+    char *data;
+    size_t len, cap;
+} JobBuffer;
+
+typedef struct ParallelJob {
+    char *input;
+    pid_t pid;
+    int out_fd, err_fd;     // -1 once drained
+    int pid_fd;             // readable once the job exits, -1 without pidfd support
+    JobBuffer out, err;
+    int status;
+    bool done;
+} ParallelJob;
+
+// Process groups of running jobs, read by the signal handler
+static volatile pid_t running[PARALLEL_MAX_SLOTS];
+static volatile sig_atomic_t interrupted = 0;
+
+void parallel_signal(int sig) {
+    bool any = false;
+    for (int i = 0; i < PARALLEL_MAX_SLOTS; i++) {
+        pid_t pid = running[i];
+        if (pid > 0) {
+            kill(-pid, sig);
+            any = true;
+        }
+    }
+    if (any) interrupted = 1;
+}
+
+static void show_parallel_help(void) {
+    printf("Usage: parallel [-j N] [-k] [-v] [--] command [args...] [::: inputs...]\n");
+    printf("Run command once per input, N at a time (default: number of CPUs).\n");
+    printf("Inputs follow ::: or are read from stdin, one per line. {} in the\n");
+    printf("command is replaced by the input, otherwise it is appended.\n\n");
+    printf("  -j N   run at most N jobs at once\n");
+    printf("  -k     print output in input order instead of as jobs finish\n");
+    printf("  -v     list the exit status of every job, not only failures\n");
+}
+
+static void buffer_append(JobBuffer *b, const char *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + len) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) return;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+// Copy arg with every "{}" replaced by input
+static char *substitute(const char *arg, const char *input, bool *used) {
+    size_t in_len = strlen(input), len = 0;
+    for (const char *p = arg; *p; p++) {
+        if (p[0] == '{' && p[1] == '}') {
+            len += in_len;
+            p++;
+        } else {
+            len++;
+        }
+    }
+
+    char *out = malloc(len + 1);
+    if (!out) return NULL;
+    char *o = out;
+    for (const char *p = arg; *p; p++) {
+        if (p[0] == '{' && p[1] == '}') {
+            memcpy(o, input, in_len);
+            o += in_len;
+            p++;
+            *used = true;
+        } else {
+            *o++ = *p;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+// Pipe whose ends are not inherited by the other jobs
+static int cloexec_pipe(int fds[2]) {
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+static pid_t spawn(String *cmd, int cmd_count, ParallelJob *job) {
+    int out[2], err[2];
+    if (cloexec_pipe(out) < 0) return -1;
+    if (cloexec_pipe(err) < 0) {
+        close(out[0]);
+        close(out[1]);
+        return -1;
+    }
+
+    char **argv = calloc(cmd_count + 2, sizeof(char *));
+    bool used = false;
+    int argc = 0;
+    for (int i = 0; argv && i < cmd_count; i++)
+        argv[argc++] = substitute(cmd[i].chars, job->input, &used);
+    if (argv && !used)
+        argv[argc++] = strdup(job->input);
+
+    pid_t pid = argv ? fork() : -1;
+    if (pid == 0) {
+        policy_child_setup(policy_defaults());
+
+        // jobs must not compete for the terminal
+        int null = open("/dev/null", O_RDONLY);
+        if (null >= 0) dup2(null, STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+
+    if (pid > 0) setpgid(pid, pid);
+    for (int i = 0; argv && i < argc; i++) free(argv[i]);
+    free(argv);
+    close(out[1]);
+    close(err[1]);
+    if (pid < 0) {
+        close(out[0]);
+        close(err[0]);
+        return -1;
+    }
+    job->out_fd = out[0];
+    job->err_fd = err[0];
+#ifdef SYS_pidfd_open
+    job->pid_fd = (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    job->pid_fd = -1;
+#endif
+    return pid;
+}
+
+// Collect a job whose pipes are closed, without blocking on one that has
+// closed them but is still running; true once it has been reaped
+static bool reap(ParallelJob *job) {
+    int status;
+    pid_t w;
+    do {
+        w = waitpid(job->pid, &status, WNOHANG);
+    } while (w == -1 && errno == EINTR);
+    if (w == 0) return false;
+
+    if (w == -1) job->status = 127;
+    else if (WIFEXITED(status)) job->status = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status)) job->status = 128 + WTERMSIG(status);
+    if (job->pid_fd >= 0) close(job->pid_fd);
+    job->pid_fd = -1;
+    job->done = true;
+    return true;
+}
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void emit(ParallelJob *job) {
+    fflush(stdout);
+    write_all(STDOUT_FILENO, job->out.data, job->out.len);
+    write_all(STDERR_FILENO, job->err.data, job->err.len);
+    free(job->out.data);
+    free(job->err.data);
+    job->out = job->err = (JobBuffer){0};
+}
+
+static char **read_inputs(String *args, int *count) {
+    int cap = 64;
+    char **inputs = malloc(cap * sizeof(char *));
+    *count = 0;
+    if (!inputs) return NULL;
+
+    if (args) {
+        for (int i = 0; args[i].chars; i++) {
+            if (*count == cap) {
+                cap *= 2;
+                char **grown = realloc(inputs, cap * sizeof(char *));
+                if (!grown) break;
+                inputs = grown;
+            }
+            inputs[(*count)++] = strdup(args[i].chars);
+        }
+        return inputs;
+    }
+
+    char line[BUFFER_MAX_SIZE];
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+        if (*count == cap) {
+            cap *= 2;
+            char **grown = realloc(inputs, cap * sizeof(char *));
+            if (!grown) break;
+            inputs = grown;
+        }
+        inputs[(*count)++] = strdup(line);
+    }
+    clearerr(stdin);
+    return inputs;
+}
+
+int builtin_parallel(String *args) {
+    int slots = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    bool keep_order = false, verbose = false;
+
+    int i = 1;
+    for (; args[i].chars && args[i].chars[0] == '-'; i++) {
+        const char *opt = args[i].chars;
+        if (strcmp(opt, "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(opt, "-j") == 0 && args[i + 1].chars) {
+            slots = atoi(args[++i].chars);
+        } else if (strncmp(opt, "-j", 2) == 0 && opt[2]) {
+            slots = atoi(opt + 2);
+        } else if (strcmp(opt, "-k") == 0) {
+            keep_order = true;
+        } else if (strcmp(opt, "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+            show_parallel_help();
+            return HERMES_SUCCESS;
+        } else {
+            fprintf(stderr, "parallel: unknown option %s\n", opt);
+            return HERMES_FAILURE;
+        }
+    }
+    if (slots < 1) slots = 1;
+    if (slots > PARALLEL_MAX_SLOTS) slots = PARALLEL_MAX_SLOTS;
+
+    String *cmd = &args[i];
+    int cmd_count = 0;
+    String *sep = NULL;
+    while (cmd[cmd_count].chars) {
+        if (strcmp(cmd[cmd_count].chars, ":::") == 0) {
+            sep = &cmd[cmd_count + 1];
+            break;
+        }
+        cmd_count++;
+    }
+    if (cmd_count == 0) {
+        show_parallel_help();
+        return HERMES_FAILURE;
+    }
+
+    int job_count;
+    char **inputs = read_inputs(sep, &job_count);
+    if (!inputs) return HERMES_FAILURE;
+
+    ParallelJob *jobs = calloc(job_count ? job_count : 1, sizeof(ParallelJob));
+    int *slot_job = malloc(slots * sizeof(int));
+    struct pollfd *pfds = malloc(slots * 2 * sizeof(struct pollfd));
+    int *pfd_slot = malloc(slots * 2 * sizeof(int));
+    if (!jobs || !slot_job || !pfds || !pfd_slot) {
+        for (int j = 0; j < job_count; j++) free(inputs[j]);
+        free(inputs);
+        free(jobs);
+        free(slot_job);
+        free(pfds);
+        free(pfd_slot);
+        return HERMES_FAILURE;
+    }
+    for (int s = 0; s < slots; s++) slot_job[s] = -1;
+
+    interrupted = 0;
+    int next = 0, active = 0, next_emit = 0, failed = 0;
+    while (next < job_count || active > 0) {
+        // Fill free slots
+        for (int s = 0; s < slots && next < job_count && !interrupted; s++) {
+            if (slot_job[s] >= 0) continue;
+            ParallelJob *job = &jobs[next];
+            job->input = inputs[next];
+            job->pid = spawn(cmd, cmd_count, job);
+            if (job->pid < 0) {
+                perror("parallel");
+                job->status = 127;
+                job->done = true;
+            } else {
+                slot_job[s] = next;
+                running[s] = job->pid;
+                active++;
+            }
+            next++;
+        }
+        if (interrupted && next < job_count) {
+            // Ctrl-C: start nothing new, let the running jobs wind down
+            for (int j = next; j < job_count; j++) {
+                jobs[j].input = inputs[j];
+                jobs[j].status = 128 + SIGINT;
+                jobs[j].done = true;
+            }
+            next = job_count;
+        }
+        if (active == 0) break;
+
+        int nfds = 0, timeout = -1;
+        for (int s = 0; s < slots; s++) {
+            if (slot_job[s] < 0) continue;
+            ParallelJob *job = &jobs[slot_job[s]];
+            if (job->out_fd < 0 && job->err_fd < 0) {
+                // Drained but still running: wait for its exit alongside the others
+                if (job->pid_fd >= 0) {
+                    pfd_slot[nfds] = s;
+                    pfds[nfds++] = (struct pollfd){.fd = job->pid_fd, .events = POLLIN};
+                } else {
+                    timeout = PARALLEL_REAP_MS;
+                }
+            }
+            if (job->out_fd >= 0) {
+                pfd_slot[nfds] = s;
+                pfds[nfds++] = (struct pollfd){.fd = job->out_fd, .events = POLLIN};
+            }
+            if (job->err_fd >= 0) {
+                pfd_slot[nfds] = s;
+                pfds[nfds++] = (struct pollfd){.fd = job->err_fd, .events = POLLIN};
+            }
+        }
+        if (poll(pfds, nfds, timeout) < 0) {
+            if (errno == EINTR) continue;
+            perror("parallel");
+            break;
+        }
+
+        char chunk[8192];
+        for (int p = 0; p < nfds; p++) {
+            if (!pfds[p].revents) continue;
+            int s = pfd_slot[p];
+            ParallelJob *job = &jobs[slot_job[s]];
+            if (pfds[p].fd == job->pid_fd) continue;    // reaped below
+            bool is_out = pfds[p].fd == job->out_fd;
+
+            ssize_t n = read(pfds[p].fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                buffer_append(is_out ? &job->out : &job->err, chunk, (size_t)n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+
+            close(pfds[p].fd);
+            if (is_out) job->out_fd = -1;
+            else job->err_fd = -1;
+        }
+
+        // Free the slots of drained jobs that have exited
+        for (int s = 0; s < slots; s++) {
+            if (slot_job[s] < 0) continue;
+            ParallelJob *job = &jobs[slot_job[s]];
+            if (job->out_fd >= 0 || job->err_fd >= 0 || !reap(job)) continue;
+            running[s] = 0;
+            slot_job[s] = -1;
+            active--;
+            if (!keep_order) emit(job);
+        }
+
+        while (keep_order && next_emit < next && jobs[next_emit].done)
+            emit(&jobs[next_emit++]);
+    }
+    while (keep_order && next_emit < job_count)
+        emit(&jobs[next_emit++]);
+
+    // Summary: every failure, or every job with -v
+    for (int j = 0; j < job_count; j++) {
+        if (jobs[j].status != 0) failed++;
+        if (jobs[j].status != 0 || verbose)
+            fprintf(stderr, "parallel: [%d] exit %d: %s\n", j + 1, jobs[j].status, jobs[j].input);
+    }
+    if (failed || verbose)
+        fprintf(stderr, "parallel: %d job%s, %d failed%s\n", job_count, job_count == 1 ? "" : "s",
+                failed, interrupted ? " (interrupted)" : "");
+
+    for (int j = 0; j < job_count; j++) free(inputs[j]);
+    free(inputs);
+    free(jobs);
+    free(slot_job);
+    free(pfds);
+    free(pfd_slot);
+    return failed ? HERMES_FAILURE : HERMES_SUCCESS;
+}
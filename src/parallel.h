@@ -0,0 +1,10 @@
+#ifndef HERMES_PARALLEL_H
+#define HERMES_PARALLEL_H
+
+#include "globals.h"
+
+// Forward a signal to every running parallel job's process group.
+// Async-signal-safe, called from the shell's SIGINT handler.
+void parallel_signal(int sig);
+
+#endif
@@ -0,0 +1,25 @@
+#include "path.h"
+
+char *path_xdg(const char *var, const char *fallback, const char *file) {
+    const char *base = getenv(var);
+    if (base && base[0] == '/') fallback = NULL;
+    else base = getenv("HOME");
+    if (!base) return NULL;
+
+    size_t len = strlen(base) + (fallback ? strlen(fallback) + 1 : 0) + strlen(file) + sizeof("/hermes/");
+    char *path = malloc(len);
+    if (!path) return NULL;
+    snprintf(path, len, "%s%s%s/hermes/%s", base, fallback ? "/" : "", fallback ? fallback : "", file);
+    return path;
+}
+
+int path_mkdir_parents(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        int r = mkdir(path, 0700);
+        *p = '/';
+        if (r == -1 && errno != EEXIST) return -1;
+    }
+    return 0;
+}
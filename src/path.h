@@ -0,0 +1,16 @@
+#ifndef HERMES_PATH_H
+#define HERMES_PATH_H
+
+#include "globals.h"
+
+/*
+ * $<var>/hermes/<file> for an XDG base directory variable, falling back to
+ * ~/<fallback>/hermes/<file> when the variable is unset or not absolute,
+ * as the spec requires. Returns a malloc'd path, NULL without $HOME.
+ */
+char *path_xdg(const char *var, const char *fallback, const char *file);
+
+// Create every missing directory before the last '/' in path, mode 0700
+int path_mkdir_parents(char *path);
+
+#endif
@@ -0,0 +1,275 @@
+#define _GNU_SOURCE     // cpu_set_t, sched_setaffinity
+#include <limits.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "builtins.h"
+#include "policy.h"
+
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+enum { IOPRIO_CLASS_RT = 1, IOPRIO_CLASS_BE = 2, IOPRIO_CLASS_IDLE = 3 };
+
+static LaunchPolicy defaults = {0};
+
+LaunchPolicy *policy_defaults(void) {
+    return &defaults;
+}
+
+static bool parse_int(const char *s, long min, long max, long *out) {
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (errno || end == s || *end || v < min || v > max) return false;
+    *out = v;
+    return true;
+}
+
+// "0-7,12,14-15"
+static bool parse_cpus(const char *spec, uint64_t *mask) {
+    memset(mask, 0, POLICY_MAX_CPUS / 8);
+    const char *p = spec;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p || lo < 0) return false;
+        p = end;
+        if (*p == '-') {
+            hi = strtol(++p, &end, 10);
+            if (end == p || hi < lo) return false;
+            p = end;
+        }
+        if (hi >= POLICY_MAX_CPUS) return false;
+        for (long cpu = lo; cpu <= hi; cpu++)
+            mask[cpu / 64] |= UINT64_C(1) << (cpu % 64);
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return p != spec;
+}
+
+// "idle", "best-effort[:0-7]", "realtime[:0-7]" (also "be" and "rt")
+static bool parse_ioprio(const char *spec, int *out) {
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    long level = 4;
+    if (colon && !parse_int(colon + 1, 0, 7, &level)) return false;
+
+    int class;
+    if (len == 4 && strncmp(spec, "idle", len) == 0 && !colon) {
+        class = IOPRIO_CLASS_IDLE;
+        level = 0;
+    } else if ((len == 2 && strncmp(spec, "be", len) == 0) || (len == 11 && strncmp(spec, "best-effort", len) == 0)) {
+        class = IOPRIO_CLASS_BE;
+    } else if ((len == 2 && strncmp(spec, "rt", len) == 0) || (len == 8 && strncmp(spec, "realtime", len) == 0)) {
+        class = IOPRIO_CLASS_RT;
+    } else {
+        return false;
+    }
+    *out = class << IOPRIO_CLASS_SHIFT | (int)level;
+    return true;
+}
+
+bool policy_option(LaunchPolicy *policy, const char *option, const char *value) {
+    // An empty value clears the option, so the config can be overridden
+    bool clear = value[0] == '\0';
+
+    if (strcmp(option, "cpus") == 0) {
+        uint64_t cpus[POLICY_MAX_CPUS / 64] = {0};
+        if (clear || parse_cpus(value, cpus)) {
+            memcpy(policy->cpus, cpus, sizeof(cpus));
+            policy->has_cpus = !clear;
+            return true;
+        }
+    } else if (strcmp(option, "nice") == 0) {
+        long nice = 0;
+        if (clear || parse_int(value, -20, 19, &nice)) {
+            policy->has_nice = !clear;
+            policy->nice = (int)nice;
+            return true;
+        }
+    } else if (strcmp(option, "ioprio") == 0) {
+        if (clear || parse_ioprio(value, &policy->ioprio)) {
+            policy->has_ioprio = !clear;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void show_with_help(void) {
+    printf("Usage: with [--cpus LIST] [--nice N] [--ioprio CLASS[:LEVEL]] [--] command [args...]\n");
+    printf("Run command with scheduling constraints, overriding the config defaults.\n\n");
+    printf("  --cpus LIST     pin to CPUs, e.g. 0-7,12\n");
+    printf("  --nice N        run at niceness N (-20..19)\n");
+    printf("  --ioprio CLASS  idle, best-effort[:0-7] or realtime[:0-7]\n");
+}
+
+int policy_parse_with(String *args, int argc, LaunchPolicy *policy) {
+    int i = 1;
+    for (; i < argc && strncmp(args[i].chars, "--", 2) == 0; i++) {
+        if (args[i].chars[2] == '\0') {
+            i++;
+            break;
+        }
+        if (strcmp(args[i].chars, "--help") == 0) {
+            show_with_help();
+            return -1;
+        }
+
+        // --option value or --option=value
+        char option[16];
+        const char *value;
+        const char *eq = strchr(args[i].chars, '=');
+        size_t len = eq ? (size_t)(eq - args[i].chars - 2) : strlen(args[i].chars + 2);
+        if (len >= sizeof(option)) len = sizeof(option) - 1;
+        memcpy(option, args[i].chars + 2, len);
+        option[len] = '\0';
+        if (eq) {
+            value = eq + 1;
+        } else if (i + 1 < argc) {
+            value = args[++i].chars;
+        } else {
+            fprintf(stderr, "with: %s expects a value\n", args[i].chars);
+            return -1;
+        }
+
+        if (!policy_option(policy, option, value)) {
+            fprintf(stderr, "with: invalid --%s %s\n", option, value);
+            return -1;
+        }
+    }
+
+    if (i >= argc) {
+        show_with_help();
+        return -1;
+    }
+    return i;
+}
+
+void policy_apply(const LaunchPolicy *policy) {
+    // Failures are reported but the command still runs, unconstrained
+    if (policy->has_cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < POLICY_MAX_CPUS && cpu < CPU_SETSIZE; cpu++)
+            if (policy->cpus[cpu / 64] & (UINT64_C(1) << (cpu % 64)))
+                CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0)
+            perror("sched_setaffinity");
+    }
+    if (policy->has_nice && setpriority(PRIO_PROCESS, 0, policy->nice) < 0)
+        perror("setpriority");
+    if (policy->has_ioprio && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, policy->ioprio) < 0)
+        perror("ioprio_set");
+}
+
+void policy_child_setup(const LaunchPolicy *policy) {
+    // Own process group, so the shell can hand it the terminal and signal it
+    setpgid(0, 0);
+
+    // The shell ignores or catches these; the command gets the defaults back
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+
+    policy_apply(policy);
+}
+
+typedef struct Limit {
+    char flag;
+    int resource;
+    rlim_t unit;
+    const char *description;
+} Limit;
+
+static const Limit limits[] = {
+    {'c', RLIMIT_CORE, 512, "core file size (blocks)"},
+    {'d', RLIMIT_DATA, 1024, "data seg size (kbytes)"},
+    {'f', RLIMIT_FSIZE, 512, "file size (blocks)"},
+    {'l', RLIMIT_MEMLOCK, 1024, "max locked memory (kbytes)"},
+    {'m', RLIMIT_RSS, 1024, "max memory size (kbytes)"},
+    {'n', RLIMIT_NOFILE, 1, "open files"},
+    {'s', RLIMIT_STACK, 1024, "stack size (kbytes)"},
+    {'t', RLIMIT_CPU, 1, "cpu time (seconds)"},
+    {'u', RLIMIT_NPROC, 1, "max user processes"},
+    {'v', RLIMIT_AS, 1024, "virtual memory (kbytes)"},
+};
+
+#define LIMIT_COUNT (int)(sizeof(limits) / sizeof(limits[0]))
+
+static void print_limit(const Limit *limit, bool hard, bool labelled) {
+    struct rlimit rl;
+    if (getrlimit(limit->resource, &rl) < 0) {
+        perror("ulimit");
+        return;
+    }
+    rlim_t value = hard ? rl.rlim_max : rl.rlim_cur;
+    if (labelled) printf("%-28s (-%c) ", limit->description, limit->flag);
+    if (value == RLIM_INFINITY) printf("unlimited\n");
+    else printf("%llu\n", (unsigned long long)(value / limit->unit));
+}
+
+// ulimit [-H|-S] [-a | -c|-d|-f|-l|-m|-n|-s|-t|-u|-v] [value|unlimited]
+int builtin_ulimit(String *args) {
+    bool hard = false, soft = false, all = false;
+    const Limit *limit = &limits[2];    // -f, as POSIX specifies
+
+    int i = 1;
+    for (; args[i].chars && args[i].chars[0] == '-' && args[i].chars[1]; i++) {
+        for (const char *f = args[i].chars + 1; *f; f++) {
+            if (*f == 'H') hard = true;
+            else if (*f == 'S') soft = true;
+            else if (*f == 'a') all = true;
+            else {
+                int l = 0;
+                while (l < LIMIT_COUNT && limits[l].flag != *f) l++;
+                if (l == LIMIT_COUNT) {
+                    fprintf(stderr, "ulimit: unknown option -%c\n", *f);
+                    return HERMES_FAILURE;
+                }
+                limit = &limits[l];
+            }
+        }
+    }
+
+    if (all) {
+        for (int l = 0; l < LIMIT_COUNT; l++) print_limit(&limits[l], hard, true);
+        fflush(stdout);
+        return HERMES_SUCCESS;
+    }
+    if (!args[i].chars) {
+        print_limit(limit, hard, false);
+        fflush(stdout);
+        return HERMES_SUCCESS;
+    }
+
+    rlim_t value;
+    if (strcmp(args[i].chars, "unlimited") == 0) {
+        value = RLIM_INFINITY;
+    } else {
+        long n;
+        if (!parse_int(args[i].chars, 0, LONG_MAX, &n)) {
+            fprintf(stderr, "ulimit: %s: invalid limit\n", args[i].chars);
+            return HERMES_FAILURE;
+        }
+        value = (rlim_t)n * limit->unit;
+    }
+
+    // Like other shells, set both limits unless one was named
+    struct rlimit rl;
+    if (getrlimit(limit->resource, &rl) < 0) {
+        perror("ulimit");
+        return HERMES_FAILURE;
+    }
+    if (hard || !soft) rl.rlim_max = value;
+    if (soft || !hard) rl.rlim_cur = value;
+    if (setrlimit(limit->resource, &rl) < 0) {
+        perror("ulimit");
+        return HERMES_FAILURE;
+    }
+    return HERMES_SUCCESS;
+}
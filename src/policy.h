@@ -0,0 +1,43 @@
+#ifndef HERMES_POLICY_H
+#define HERMES_POLICY_H
+
+#include <stdint.h>
+#include "globals.h"
+
+#define POLICY_MAX_CPUS 1024
+
+/*
+ * Scheduling constraints applied to a child between fork and exec. The
+ * config file sets the defaults (NICE=, CPUS=, IOPRIO=) and the with
+ * prefix overrides them for one command.
+ */
+typedef struct LaunchPolicy {
+    bool has_cpus, has_nice, has_ioprio;
+    uint64_t cpus[POLICY_MAX_CPUS / 64];    // affinity mask
+    int nice;                               // absolute niceness, -20..19
+    int ioprio;                             // kernel encoding, class << 13 | level
+} LaunchPolicy;
+
+LaunchPolicy *policy_defaults(void);
+
+// Set one option ("cpus", "nice" or "ioprio") from its textual value
+bool policy_option(LaunchPolicy *policy, const char *option, const char *value);
+
+/*
+ * Parse "with [--cpus LIST] [--nice N] [--ioprio CLASS[:LEVEL]] [--] cmd"
+ * into policy and return the index of cmd in args, or -1 after printing
+ * an error.
+ */
+int policy_parse_with(String *args, int argc, LaunchPolicy *policy);
+
+// Apply the policy to the calling process; only call in a forked child
+void policy_apply(const LaunchPolicy *policy);
+
+/*
+ * Everything a forked child needs before exec: its own process group,
+ * default job-control signal handlers and the policy. Shared by every
+ * place that starts external commands.
+ */
+void policy_child_setup(const LaunchPolicy *policy);
+
+#endif
@@ -0,0 +1,166 @@
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "shared_history.h"
+
+#define SHARED_HISTORY_MAGIC 0x48524d53u   // "HRMS"
+#define SHARED_HISTORY_VERSION 1
+#define SHARED_HISTORY_SLOTS 2048
+#define SHARED_HISTORY_TEXT 1000
+// An unpublished slot is given up on once this many later entries exist...
+#define SHARED_HISTORY_STALL_LAG 64
+// ...or once this many pulls in a row have stopped at it
+#define SHARED_HISTORY_STALL_PULLS 3
+
+typedef struct SharedSlot {
+    _Atomic uint64_t seq;   // sequence held here, 0 while being rewritten
+    pid_t pid;
+    uint32_t len;
+    char text[SHARED_HISTORY_TEXT];
+} SharedSlot;
+
+typedef struct SharedRing {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t slot_size;
+    _Atomic uint64_t head;  // last sequence handed out
+    SharedSlot slot[SHARED_HISTORY_SLOTS];
+} SharedRing;
+
+static int enabled = -1;            // -1: not decided, look at the environment
+static SharedRing *ring = NULL;
+static bool ring_failed = false;
+static uint64_t last_seen = 0;
+static uint64_t stalled_on = 0;     // sequence the previous pull stopped at
+static int stalled_pulls = 0;
+
+void shared_history_enable(bool enable) {
+    enabled = enable;
+}
+
+bool shared_history_enabled(void) {
+    if (enabled < 0) {
+        const char *env = getenv("HERMES_SHARE_HISTORY");
+        enabled = env && *env && strcmp(env, "0") != 0;
+    }
+    return enabled;
+}
+
+static SharedRing *ring_open(void) {
+    if (ring || ring_failed || !shared_history_enabled())
+        return ring;
+    ring_failed = true;
+
+    char shm_name[64];
+    snprintf(shm_name, sizeof(shm_name), "/hermes-history-%u", (unsigned)getuid());
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return NULL;
+
+    // The name is predictable and /dev/shm is world-writable: only trust a
+    // segment that is ours and that nobody else can write into
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || sb.st_uid != getuid() || (sb.st_mode & 077) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // A fresh segment is zero-filled, which is already a valid empty ring
+    if (sb.st_size < (off_t)sizeof(SharedRing) && ftruncate(fd, sizeof(SharedRing)) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    SharedRing *r = mmap(NULL, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED)
+        return NULL;
+
+    if (r->magic == 0) {
+        r->version = SHARED_HISTORY_VERSION;
+        r->slots = SHARED_HISTORY_SLOTS;
+        r->slot_size = sizeof(SharedSlot);
+        r->magic = SHARED_HISTORY_MAGIC;
+    }
+    if (r->magic != SHARED_HISTORY_MAGIC || r->version != SHARED_HISTORY_VERSION ||
+        r->slots != SHARED_HISTORY_SLOTS || r->slot_size != sizeof(SharedSlot)) {
+        munmap(r, sizeof(SharedRing));
+        return NULL;
+    }
+
+    ring_failed = false;
+    ring = r;
+    last_seen = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return ring;
+}
+
+void shared_history_mark(void) {
+    if (ring_open())
+        last_seen = atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+void shared_history_publish(const char *command) {
+    if (!ring_open())
+        return;
+
+    size_t len = strlen(command);
+    if (len >= SHARED_HISTORY_TEXT)
+        return;
+
+    uint64_t seq = atomic_fetch_add_explicit(&ring->head, 1, memory_order_acq_rel) + 1;
+    SharedSlot *slot = &ring->slot[seq % SHARED_HISTORY_SLOTS];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->pid = getpid();
+    slot->len = (uint32_t)len;
+    memcpy(slot->text, command, len + 1);
+    atomic_store_explicit(&slot->seq, seq, memory_order_release);
+}
+
+void shared_history_pull(void (*add)(const char *command)) {
+    if (!ring_open())
+        return;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    // Anything older than one lap has been overwritten already
+    if (head - last_seen > SHARED_HISTORY_SLOTS)
+        last_seen = head - SHARED_HISTORY_SLOTS;
+
+    pid_t self = getpid();
+    char text[SHARED_HISTORY_TEXT];
+    while (last_seen < head) {
+        uint64_t want = last_seen + 1;
+        SharedSlot *slot = &ring->slot[want % SHARED_HISTORY_SLOTS];
+
+        uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before < want) {
+            // Still being written, or its writer died before publishing it
+            if (want != stalled_on) {
+                stalled_on = want;
+                stalled_pulls = 0;
+            }
+            if (head - want < SHARED_HISTORY_STALL_LAG && ++stalled_pulls < SHARED_HISTORY_STALL_PULLS)
+                break;          // pick it up next time
+            last_seen = want;
+            continue;
+        }
+        if (before > want) {
+            last_seen = want;   // lapped by a writer, the entry is gone
+            continue;
+        }
+
+        pid_t pid = slot->pid;
+        uint32_t len = slot->len;
+        if (len >= SHARED_HISTORY_TEXT) len = SHARED_HISTORY_TEXT - 1;
+        memcpy(text, slot->text, len);
+        text[len] = '\0';
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == want && pid != self)
+            add(text);
+        last_seen = want;
+    }
+}
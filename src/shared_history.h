@@ -0,0 +1,24 @@
+#ifndef HERMES_SHARED_HISTORY_H
+#define HERMES_SHARED_HISTORY_H
+
+#include "globals.h"
+
+/*
+ * Opt-in ring of recent commands in a per-user shared memory segment, so
+ * live sessions see each other's history without re-reading ~/.history.
+ * Writers claim a slot with an atomic sequence counter; readers remember
+ * the last sequence they pulled and only copy what is new.
+ */
+
+void shared_history_enable(bool enable);
+bool shared_history_enabled(void);
+
+// Start pulling from the current head; earlier entries are already on disk
+void shared_history_mark(void);
+
+void shared_history_publish(const char *command);
+
+// Call add() for every entry another session published since the last pull
+void shared_history_pull(void (*add)(const char *command));
+
+#endif
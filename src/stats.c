@@ -0,0 +1,107 @@
+#include "builtins.h"
+#include "stats.h"
+
+static CommandStats last = {0};
+
+static char *trace_path = NULL;
+static bool trace_checked = false;
+
+static double tv_ms(struct timeval tv) {
+    return (double)tv.tv_sec * 1e3 + (double)tv.tv_usec / 1e3;
+}
+
+void stats_set_trace(const char *path) {
+    free(trace_path);
+    trace_path = path && *path ? strdup(path) : NULL;
+    trace_checked = true;
+}
+
+static void json_string(FILE *out, String *args, int argc) {
+    fputc('"', out);
+    for (int i = 0; i < argc; i++) {
+        if (i > 0) fputc(' ', out);
+        for (const char *p = args[i].chars; p && *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+            else if (c < 0x20) fprintf(out, "\\u%04x", c);
+            else fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void trace(String *args, int argc) {
+    if (!trace_checked) {
+        stats_set_trace(getenv("HERMES_TRACE"));
+    }
+    if (!trace_path) return;
+
+    FILE *out = fopen(trace_path, "a");
+    if (!out) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    fprintf(out, "{\"time\":%lld.%03ld,\"cmd\":", (long long)now.tv_sec, now.tv_nsec / 1000000);
+    json_string(out, args, argc);
+    fprintf(out, ",\"builtin\":%s,\"status\":%d,\"wall_ms\":%.3f,\"user_ms\":%.3f,\"sys_ms\":%.3f,"
+                 "\"maxrss_kb\":%ld,\"minflt\":%ld,\"majflt\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld}\n",
+            last.builtin ? "true" : "false", last.status, last.wall_ms,
+            tv_ms(last.usage.ru_utime), tv_ms(last.usage.ru_stime),
+            last.usage.ru_maxrss, last.usage.ru_minflt, last.usage.ru_majflt,
+            last.usage.ru_nvcsw, last.usage.ru_nivcsw);
+    fclose(out);
+}
+
+void stats_record(String *args, int argc, int status, bool builtin,
+                  const struct timespec *start, const struct rusage *usage) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    last.status = status;
+    last.builtin = builtin;
+    last.wall_ms = (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+    if (usage) last.usage = *usage;
+    else memset(&last.usage, 0, sizeof(last.usage));
+
+    trace(args, argc);
+}
+
+const CommandStats *stats_last(void) {
+    return &last;
+}
+
+static void print_minutes(double ms) {
+    long minutes = (long)(ms / 60000.0);
+    printf("%ldm%.3fs", minutes, (ms - (double)minutes * 60000.0) / 1000.0);
+}
+
+// POSIX times: accumulated user/system time of the shell, then its children
+int builtin_times(String *args) {
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    print_minutes(tv_ms(self.ru_utime));
+    printf(" ");
+    print_minutes(tv_ms(self.ru_stime));
+    printf("\n");
+    print_minutes(tv_ms(children.ru_utime));
+    printf(" ");
+    print_minutes(tv_ms(children.ru_stime));
+    printf("\n");
+    fflush(stdout);
+    return HERMES_SUCCESS;
+}
+
+int builtin_laststat(String *args) {
+    printf("status     %d%s\n", last.status, last.builtin ? " (builtin)" : "");
+    printf("wall       %.3f ms\n", last.wall_ms);
+    printf("user       %.3f ms\n", tv_ms(last.usage.ru_utime));
+    printf("sys        %.3f ms\n", tv_ms(last.usage.ru_stime));
+    printf("max rss    %ld KiB\n", last.usage.ru_maxrss);
+    printf("faults     %ld minor, %ld major\n", last.usage.ru_minflt, last.usage.ru_majflt);
+    printf("switches   %ld voluntary, %ld involuntary\n", last.usage.ru_nvcsw, last.usage.ru_nivcsw);
+    fflush(stdout);
+    return HERMES_SUCCESS;
+}
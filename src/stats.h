@@ -0,0 +1,24 @@
+#ifndef HERMES_STATS_H
+#define HERMES_STATS_H
+
+#include <sys/resource.h>
+#include <time.h>
+#include "globals.h"
+
+typedef struct CommandStats {
+    int status;             // exit status of this command; $? is ast_eval()'s, after any !
+    bool builtin;
+    double wall_ms;
+    struct rusage usage;    // children: from wait4(), builtins: RUSAGE_SELF delta
+} CommandStats;
+
+// Record a finished command and append it to the trace file if one is set
+void stats_record(String *args, int argc, int status, bool builtin,
+                  const struct timespec *start, const struct rusage *usage);
+
+const CommandStats *stats_last(void);
+
+// Opt-in JSON-lines trace, also enabled by $HERMES_TRACE
+void stats_set_trace(const char *path);
+
+#endif
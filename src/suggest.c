@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include "suggest.h"
+
+#define NO_NODE UINT32_MAX
+
+typedef struct SuggestNode {
+    int entry;              // history entry the label is taken from
+    uint32_t offset, len;   // label = text(entry)[offset, offset + len)
+    int best;               // most recent entry with this prefix
+    uint32_t child;         // first child, children sorted by first byte
+    uint32_t sibling;
+} SuggestNode;
+
+static SuggestNode *nodes = NULL;
+static uint32_t node_count = 0, node_cap = 0;
+static suggest_text_fn entry_text = NULL;
+
+static uint32_t new_node(int entry, uint32_t offset, uint32_t len) {
+    if (node_count == node_cap) {
+        uint32_t cap = node_cap ? node_cap * 2 : 1024;
+        SuggestNode *grown = realloc(nodes, cap * sizeof(SuggestNode));
+        if (!grown) return NO_NODE;
+        nodes = grown;
+        node_cap = cap;
+    }
+    nodes[node_count] = (SuggestNode){
+        .entry = entry, .offset = offset, .len = len, .best = entry,
+        .child = NO_NODE, .sibling = NO_NODE,
+    };
+    return node_count++;
+}
+
+static const char *label(uint32_t n) {
+    return entry_text(nodes[n].entry) + nodes[n].offset;
+}
+
+void suggest_init(suggest_text_fn text) {
+    entry_text = text;
+    suggest_clear();
+}
+
+void suggest_clear(void) {
+    free(nodes);
+    nodes = NULL;
+    node_count = node_cap = 0;
+}
+
+// Link n under parent, keeping siblings ordered by first byte
+static void add_child(uint32_t parent, uint32_t n) {
+    unsigned char c = (unsigned char)label(n)[0];
+    uint32_t *link = &nodes[parent].child;
+    while (*link != NO_NODE && (unsigned char)label(*link)[0] < c)
+        link = &nodes[*link].sibling;
+    nodes[n].sibling = *link;
+    *link = n;
+}
+
+// Child of parent whose label starts with c; *link is left pointing at it
+static uint32_t *find_child(uint32_t parent, unsigned char c) {
+    uint32_t *link = &nodes[parent].child;
+    while (*link != NO_NODE) {
+        unsigned char first = (unsigned char)label(*link)[0];
+        if (first == c) return link;
+        if (first > c) break;
+        link = &nodes[*link].sibling;
+    }
+    return NULL;
+}
+
+void suggest_insert(int entry) {
+    if (!entry_text) return;
+    const char *s = entry_text(entry);
+    if (!s || !*s) return;
+
+    if (node_count == 0 && new_node(-1, 0, 0) == NO_NODE) return;
+
+    uint32_t node = 0;
+    uint32_t pos = 0;
+    nodes[0].best = entry;
+
+    while (s[pos]) {
+        uint32_t *link = find_child(node, (unsigned char)s[pos]);
+        if (!link) {
+            uint32_t leaf = new_node(entry, pos, (uint32_t)strlen(s + pos));
+            if (leaf != NO_NODE) add_child(node, leaf);
+            return;
+        }
+
+        uint32_t child = *link;
+        const char *l = label(child);
+        uint32_t common = 0;
+        while (common < nodes[child].len && s[pos + common] == l[common]) common++;
+
+        if (common == nodes[child].len) {
+            nodes[child].best = entry;
+            node = child;
+            pos += common;
+            continue;
+        }
+
+        // Split the edge: a new node takes the shared part of the label
+        uint32_t mid = new_node(nodes[child].entry, nodes[child].offset, common);
+        if (mid == NO_NODE) return;
+        link = find_child(node, (unsigned char)s[pos]);    // nodes may have moved
+        nodes[mid].best = entry;
+        nodes[mid].sibling = nodes[child].sibling;
+        nodes[mid].child = child;
+        *link = mid;
+        nodes[child].offset += common;
+        nodes[child].len -= common;
+        nodes[child].sibling = NO_NODE;
+
+        pos += common;
+        if (s[pos]) {
+            uint32_t leaf = new_node(entry, pos, (uint32_t)strlen(s + pos));
+            if (leaf != NO_NODE) add_child(mid, leaf);
+        }
+        return;
+    }
+}
+
+int suggest_lookup(const char *prefix) {
+    if (node_count == 0 || !prefix) return -1;
+
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (prefix[pos]) {
+        uint32_t *link = find_child(node, (unsigned char)prefix[pos]);
+        if (!link) return -1;
+
+        uint32_t child = *link;
+        const char *l = label(child);
+        uint32_t i = 0;
+        while (i < nodes[child].len && prefix[pos + i]) {
+            if (prefix[pos + i] != l[i]) return -1;
+            i++;
+        }
+        pos += i;
+        node = child;
+    }
+    return nodes[node].best;
+}
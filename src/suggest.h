@@ -0,0 +1,21 @@
+#ifndef HERMES_SUGGEST_H
+#define HERMES_SUGGEST_H
+
+#include "globals.h"
+
+/*
+ * Radix trie over the session history used for autosuggestions. Edge
+ * labels are stored as (entry, offset, length) into the history itself,
+ * so the trie never copies command text. Every node remembers the most
+ * recent entry below it, which makes a lookup O(prefix length).
+ */
+
+typedef const char *(*suggest_text_fn)(int entry);
+
+void suggest_init(suggest_text_fn text);
+void suggest_insert(int entry);
+// Most recent entry starting with prefix, or -1
+int suggest_lookup(const char *prefix);
+void suggest_clear(void);
+
+#endif